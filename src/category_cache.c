@@ -0,0 +1,86 @@
+/* =============================================================================
+   Program Name: FancyD (Fancy Directory Organizer)
+   Author: Nicholas D. Redmond (3A3YN1CKY)
+   Date: 8/13/2024
+   Description: Simple program to organize files in a directory.
+   ============================================================================= */
+
+#include <category_cache.h>
+#include <move_journal.h>
+
+void category_cache_init(CategoryCache *cache, int dir_fd, const char *directory) {
+    memset(cache, 0, sizeof(*cache));
+    cache->dir_fd = dir_fd;
+    cache->directory = directory;
+}
+
+static int open_category_dir(const CategoryCache *cache, const char *category) {
+    // Most runs find the category already there, so try opening first
+    int fd = openat(cache->dir_fd, category, O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (fd != -1 || errno != ENOENT) {
+        return fd;
+    }
+
+    if (mkdirat(cache->dir_fd, category, 0777) == 0) {
+        // Only folders made here may be removed again by an undo
+        journal_category_created(cache->directory, category);
+    } else if (errno != EEXIST) {
+        return -1;
+    }
+    return openat(cache->dir_fd, category, O_PATH | O_DIRECTORY | O_CLOEXEC);
+}
+
+CategoryDir *category_cache_get(CategoryCache *cache, const char *category) {
+    // Interned names usually match by pointer; fall back to strcmp for
+    // literals like "misc" before treating it as a new category
+    for (size_t i = 0; i < cache->count; i++) {
+        if (cache->dirs[i]->category == category) return cache->dirs[i];
+    }
+    for (size_t i = 0; i < cache->count; i++) {
+        if (strcmp(cache->dirs[i]->category, category) == 0) return cache->dirs[i];
+    }
+
+    if (cache->count == cache->capacity) {
+        size_t capacity = cache->capacity ? cache->capacity * 2 : 16;
+        CategoryDir **dirs = realloc(cache->dirs, sizeof(CategoryDir *) * capacity);
+        if (dirs == NULL) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        cache->dirs = dirs;
+        cache->capacity = capacity;
+    }
+
+    CategoryDir *dir = calloc(1, sizeof(CategoryDir));
+    if (dir == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+
+    dir->fd = open_category_dir(cache, category);
+    if (dir->fd == -1) {
+        fprintf(stderr, "Failed to create category directory: %s\n", category);
+    }
+    dir->category = category;
+    pthread_mutex_init(&dir->lock, NULL);
+
+    // Failures are cached too so a bad category is reported only once
+    cache->dirs[cache->count++] = dir;
+    return dir;
+}
+
+void category_cache_destroy(CategoryCache *cache) {
+    for (size_t i = 0; i < cache->count; i++) {
+        CategoryDir *dir = cache->dirs[i];
+        if (dir->fd != -1) {
+            close(dir->fd);
+        }
+        free(dir->existing.names);
+        free(dir->existing.table);
+        pthread_mutex_destroy(&dir->lock);
+        free(dir);
+    }
+    free(cache->dirs);
+    memset(cache, 0, sizeof(*cache));
+    cache->dir_fd = -1;
+}
@@ -0,0 +1,49 @@
+/* =============================================================================
+   Program Name: FancyD (Fancy Directory Organizer)
+   Author: Nicholas D. Redmond (3A3YN1CKY)
+   Date: 8/13/2024
+   Description: Simple program to organize files in a directory.
+   ============================================================================= */
+
+#ifndef CATEGORY_CACHE_H
+#define CATEGORY_CACHE_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <fancy.h>
+
+typedef struct {
+    char *names;
+    size_t names_used;
+    size_t names_size;
+    uint32_t *table;            // open addressing, name offset + 1, 0 = empty
+    size_t capacity;
+    size_t count;
+} NameSet;
+
+typedef struct {
+    const char *category;
+    int fd;
+    pthread_mutex_t lock;       // guards existing; move workers share it
+    bool loaded;
+    NameSet existing;           // names already in the folder, read on first need
+} CategoryDir;
+
+// Per-run table of open category directories under one source directory.
+// The source directory fd and path are borrowed from the caller.
+// Each category is created (if needed) and opened once; after that moves
+// are a single renameat between two directory fds. Entries are allocated
+// one by one so the pointers handed out stay valid while the table grows.
+typedef struct {
+    int dir_fd;
+    const char *directory;      // for journaling the folders we create
+    CategoryDir **dirs;
+    size_t count;
+    size_t capacity;
+} CategoryCache;
+
+void category_cache_init(CategoryCache *cache, int dir_fd, const char *directory);
+CategoryDir *category_cache_get(CategoryCache *cache, const char *category);
+void category_cache_destroy(CategoryCache *cache);
+
+#endif // CATEGORY_CACHE_H
@@ -0,0 +1,261 @@
+/* =============================================================================
+   Program Name: FancyD (Fancy Directory Organizer)
+   Author: Nicholas D. Redmond (3A3YN1CKY)
+   Date: 8/13/2024
+   Description: Simple program to organize files in a directory.
+   ============================================================================= */
+
+#include <collision.h>
+#include <dir_reader.h>
+#include <xdev_move.h>
+#include <move_journal.h>
+
+#define COMPARE_BUFFER_SIZE (64 * 1024)
+
+CollisionPolicy collision_policy = COLLISION_SUFFIX;
+
+int parse_collision_policy(const char *name, CollisionPolicy *policy) {
+    if (strcmp(name, "suffix") == 0) {
+        *policy = COLLISION_SUFFIX;
+    } else if (strcmp(name, "skip") == 0) {
+        *policy = COLLISION_SKIP;
+    } else if (strcmp(name, "compare") == 0) {
+        *policy = COLLISION_COMPARE;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+static size_t name_slot(const char *name, size_t capacity) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (; *name; name++) {
+        hash ^= (unsigned char)*name;
+        hash *= 1099511628211ULL;
+    }
+    return (size_t)(hash & (capacity - 1));
+}
+
+bool name_set_contains(const NameSet *set, const char *name) {
+    if (set->capacity == 0) return false;
+
+    for (size_t slot = name_slot(name, set->capacity); set->table[slot] != 0; slot = (slot + 1) & (set->capacity - 1)) {
+        if (strcmp(set->names + set->table[slot] - 1, name) == 0) return true;
+    }
+    return false;
+}
+
+static void name_set_resize(NameSet *set, size_t capacity) {
+    uint32_t *table = calloc(capacity, sizeof(uint32_t));
+    if (table == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+
+    for (size_t i = 0; i < set->capacity; i++) {
+        if (set->table[i] == 0) continue;
+        size_t slot = name_slot(set->names + set->table[i] - 1, capacity);
+        while (table[slot] != 0) slot = (slot + 1) & (capacity - 1);
+        table[slot] = set->table[i];
+    }
+
+    free(set->table);
+    set->table = table;
+    set->capacity = capacity;
+}
+
+void name_set_add(NameSet *set, const char *name) {
+    if (name_set_contains(set, name)) return;
+
+    size_t len = strlen(name) + 1;
+    if (set->names_used + len > UINT32_MAX - 1) return;
+
+    if ((set->count + 1) * 2 > set->capacity) {
+        name_set_resize(set, set->capacity ? set->capacity * 2 : 64);
+    }
+
+    if (set->names_used + len > set->names_size) {
+        size_t size = set->names_size ? set->names_size * 2 : 4096;
+        while (size < set->names_used + len) size *= 2;
+        char *names = realloc(set->names, size);
+        if (names == NULL) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        set->names = names;
+        set->names_size = size;
+    }
+
+    memcpy(set->names + set->names_used, name, len);
+    size_t slot = name_slot(name, set->capacity);
+    while (set->table[slot] != 0) slot = (slot + 1) & (set->capacity - 1);
+    set->table[slot] = (uint32_t)set->names_used + 1;
+    set->names_used += len;
+    set->count++;
+}
+
+// Called with dir->lock held
+static void load_existing_names(CategoryDir *dir) {
+    if (dir->loaded) return;
+    dir->loaded = true;
+
+    // The category fd is O_PATH; a readable one is needed for getdents
+    int fd = openat(dir->fd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1) return;
+
+    DirReader reader;
+    if (dir_reader_open_fd(&reader, fd, DEFAULT_DIR_BUFFER_SIZE) == 0) {
+        DirEntry *entries;
+        long count;
+        while ((count = dir_reader_next_batch(&reader, &entries)) > 0) {
+            for (long i = 0; i < count; i++) {
+                if (!is_special_directory(entries[i].name)) name_set_add(&dir->existing, entries[i].name);
+            }
+        }
+        dir_reader_close(&reader);
+    }
+    close(fd);
+}
+
+// Fails with EEXIST instead of replacing dest_name
+static int rename_noreplace(int dir_fd, const char *name, CategoryDir *dir, const char *dest_name) {
+#ifdef RENAME_NOREPLACE
+    if (renameat2(dir_fd, name, dir->fd, dest_name, RENAME_NOREPLACE) == 0) return 0;
+    if (errno == EXDEV) return move_across_devices(dir_fd, name, dir->fd, dest_name);
+    if (errno != EINVAL && errno != ENOSYS) return -1;
+#endif
+
+    // No atomic no-replace rename on this filesystem, so the folder's
+    // name set stands in for it
+    pthread_mutex_lock(&dir->lock);
+    load_existing_names(dir);
+    int result = -1;
+    if (name_set_contains(&dir->existing, dest_name)) {
+        errno = EEXIST;
+    } else if (move_file_at(dir_fd, name, dir->fd, dest_name) == 0) {
+        name_set_add(&dir->existing, dest_name);
+        result = 0;
+    }
+    pthread_mutex_unlock(&dir->lock);
+    return result;
+}
+
+static bool same_contents(int dir_fd, const char *name, int category_fd, const char *existing) {
+    int a = openat(dir_fd, name, O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+    int b = openat(category_fd, existing, O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+    bool same = false;
+
+    struct stat sa, sb;
+    if (a != -1 && b != -1 && fstat(a, &sa) == 0 && fstat(b, &sb) == 0 &&
+        S_ISREG(sa.st_mode) && S_ISREG(sb.st_mode) && sa.st_size == sb.st_size) {
+        char *buffer = malloc(2 * COMPARE_BUFFER_SIZE);
+        if (buffer == NULL) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+
+        // Only two files, so comparing bytes costs no more I/O than
+        // hashing both and can't be fooled by a hash collision
+        same = true;
+        for (off_t offset = 0; same && offset < sa.st_size; ) {
+            ssize_t ra = pread(a, buffer, COMPARE_BUFFER_SIZE, offset);
+            ssize_t rb = pread(b, buffer + COMPARE_BUFFER_SIZE, COMPARE_BUFFER_SIZE, offset);
+            same = ra > 0 && ra == rb && memcmp(buffer, buffer + COMPARE_BUFFER_SIZE, ra) == 0;
+            offset += ra > 0 ? ra : 0;
+        }
+        free(buffer);
+    }
+
+    if (a != -1) close(a);
+    if (b != -1) close(b);
+    return same;
+}
+
+static bool suffixed_name(const char *name, unsigned n, char *out) {
+    // "report.pdf" -> "report-1.pdf" and "a.tar.gz" -> "a-1.tar.gz", so a
+    // compound extension still classifies the same; dotfiles and names
+    // without an extension just get the suffix on the end
+    const char *dot = strchr(name + strspn(name, "."), '.');
+    if (dot == NULL) dot = name + strlen(name);
+    int written = snprintf(out, NAME_MAX + 1, "%.*s-%u%s", (int)(dot - name), name, n, dot);
+    return written > 0 && written <= NAME_MAX;
+}
+
+PlaceResult place_in_category(int dir_fd, const char *name, CategoryDir *dir, char *dest_name) {
+    snprintf(dest_name, NAME_MAX + 1, "%s", name);
+    if (rename_noreplace(dir_fd, name, dir, dest_name) == 0) return PLACE_MOVED;
+    if (errno != EEXIST) return PLACE_FAILED;
+
+    if (collision_policy == COLLISION_SKIP) return PLACE_KEPT;
+    if (collision_policy == COLLISION_COMPARE && same_contents(dir_fd, name, dir->fd, name)) return PLACE_KEPT;
+
+    // Read the folder once so picking a free name isn't a probe per try
+    pthread_mutex_lock(&dir->lock);
+    load_existing_names(dir);
+    name_set_add(&dir->existing, name);
+    pthread_mutex_unlock(&dir->lock);
+
+    for (unsigned n = 1; n <= MAX_COLLISION_SUFFIX; n++) {
+        if (!suffixed_name(name, n, dest_name)) {
+            errno = ENAMETOOLONG;
+            return PLACE_FAILED;
+        }
+
+        pthread_mutex_lock(&dir->lock);
+        bool taken = name_set_contains(&dir->existing, dest_name);
+        pthread_mutex_unlock(&dir->lock);
+
+        if (taken) {
+            if (collision_policy == COLLISION_COMPARE && same_contents(dir_fd, name, dir->fd, dest_name)) {
+                return PLACE_KEPT;
+            }
+            continue;
+        }
+
+        if (rename_noreplace(dir_fd, name, dir, dest_name) == 0) {
+            pthread_mutex_lock(&dir->lock);
+            name_set_add(&dir->existing, dest_name);
+            pthread_mutex_unlock(&dir->lock);
+            return PLACE_MOVED;
+        }
+        if (errno != EEXIST) return PLACE_FAILED;
+
+        // Appeared since the folder was read; note it and keep going
+        pthread_mutex_lock(&dir->lock);
+        name_set_add(&dir->existing, dest_name);
+        pthread_mutex_unlock(&dir->lock);
+        n--;
+    }
+
+    errno = EEXIST;
+    return PLACE_FAILED;
+}
+
+void move_into_category(int dir_fd, const char *directory, const char *name, CategoryDir *dir, MoveStats *stats) {
+    char dest_name[NAME_MAX + 1];
+
+    switch (place_in_category(dir_fd, name, dir, dest_name)) {
+        case PLACE_MOVED:
+            journal_move(directory, name, dir->category, dest_name);
+            if (verbose) {
+                if (strcmp(name, dest_name) == 0) {
+                    printf("Moved %s to %s\n", name, dir->category);
+                } else {
+                    printf("Moved %s to %s as %s\n", name, dir->category, dest_name);
+                }
+            }
+            stats->moved++;
+            break;
+        case PLACE_KEPT:
+            if (verbose) {
+                printf("Leaving %s in place, %s already has one\n", name, dir->category);
+            }
+            stats->skipped++;
+            break;
+        case PLACE_FAILED:
+            fprintf(stderr, "Failed to move %s/%s to %s/%s: %s\n",
+                    directory, name, directory, dir->category, strerror(errno));
+            stats->failed++;
+            break;
+    }
+}
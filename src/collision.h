@@ -0,0 +1,45 @@
+/* =============================================================================
+   Program Name: FancyD (Fancy Directory Organizer)
+   Author: Nicholas D. Redmond (3A3YN1CKY)
+   Date: 8/13/2024
+   Description: Simple program to organize files in a directory.
+   ============================================================================= */
+
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include <category_cache.h>
+
+#define MAX_COLLISION_SUFFIX 100000
+
+// What to do when the category already has a file with the same name
+typedef enum {
+    COLLISION_SUFFIX,   // move it in as name-1.ext, name-2.ext, ...
+    COLLISION_SKIP,     // leave it where it is
+    COLLISION_COMPARE   // leave it if an existing copy has the same contents, else suffix
+} CollisionPolicy;
+
+typedef enum {
+    PLACE_MOVED,
+    PLACE_KEPT,         // left in place by the policy
+    PLACE_FAILED        // errno is set
+} PlaceResult;
+
+// Moves dir_fd/name into the category without ever replacing a file
+// there. renameat2(RENAME_NOREPLACE) makes the common case a single
+// system call; the folder's names are only read, once, after the first
+// collision or where the filesystem can't refuse to replace atomically.
+// dest_name (NAME_MAX + 1 bytes) receives the name the file ended up with.
+PlaceResult place_in_category(int dir_fd, const char *name, CategoryDir *dir, char *dest_name);
+
+// place_in_category plus the reporting every move path shares: the error
+// or verbose message, the journal record and the counters
+void move_into_category(int dir_fd, const char *directory, const char *name, CategoryDir *dir, MoveStats *stats);
+
+int parse_collision_policy(const char *name, CollisionPolicy *policy);
+bool name_set_contains(const NameSet *set, const char *name);
+void name_set_add(NameSet *set, const char *name);
+
+extern CollisionPolicy collision_policy;
+
+#endif // COLLISION_H
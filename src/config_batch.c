@@ -0,0 +1,280 @@
+/* =============================================================================
+   Program Name: FancyD (Fancy Directory Organizer)
+   Author: Nicholas D. Redmond (3A3YN1CKY)
+   Date: 8/13/2024
+   Description: Simple program to organize files in a directory.
+   ============================================================================= */
+
+#include <config_batch.h>
+#include <rule_cache.h>
+#include <glob_rules.h>
+
+#define MAX_EXTENSION_LENGTH 256
+
+void config_batch_init(ConfigBatch *batch, const char *config_folder, ConflictPolicy policy) {
+    memset(batch, 0, sizeof(*batch));
+    batch->config_folder = config_folder;
+    batch->policy = policy;
+}
+
+static CategoryDocument *get_document(ConfigBatch *batch, const char *category) {
+    // Categories are interned, so one pointer compare finds the document
+    for (size_t i = 0; i < batch->count; i++) {
+        if (batch->documents[i].category == category) return &batch->documents[i];
+    }
+
+    if (batch->count == batch->capacity) {
+        size_t capacity = batch->capacity ? batch->capacity * 2 : 16;
+        CategoryDocument *documents = realloc(batch->documents, sizeof(CategoryDocument) * capacity);
+        if (documents == NULL) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        batch->documents = documents;
+        batch->capacity = capacity;
+    }
+
+    char *config_path = construct_config_path(batch->config_folder, category);
+    if (config_path == NULL) {
+        exit(1);
+    }
+
+    CategoryDocument *document = &batch->documents[batch->count++];
+    document->category = category;
+    document->json = load_or_create_json(config_path);
+    document->dirty = false;
+    free(config_path);
+    return document;
+}
+
+int config_batch_set(ConfigBatch *batch, const char *extension, const char *category) {
+    if (extension[0] == '\0' || !is_plain_name(category)) {
+        fprintf(stderr, "Invalid mapping: '%s' -> '%s'\n", extension, category);
+        return -1;
+    }
+
+    const char *interned = intern_category(category);
+    bool replacing = false;
+
+    // Loop because the same extension may be listed in more than one config
+    int idx;
+    while ((idx = find_mapping_index(extension)) >= 0) {
+        const char *current = mappings[idx].category;
+        if (current == interned) {
+            if (!replacing) batch->unchanged++;
+            return 0;
+        }
+
+        if (batch->policy == CONFLICT_KEEP) {
+            if (verbose) {
+                printf("Keeping extension %s in category %s\n", extension, current);
+            }
+            batch->kept++;
+            return 0;
+        }
+        if (batch->policy == CONFLICT_ABORT) {
+            fprintf(stderr, "Extension %s is already in category %s\n", extension, current);
+            return -1;
+        }
+
+        CategoryDocument *old = get_document(batch, current);
+        cJSON_DeleteItemFromObject(old->json, mappings[idx].extension);
+        old->dirty = true;
+        remove_mapping(extension);
+        replacing = true;
+    }
+
+    CategoryDocument *document = get_document(batch, interned);
+    cJSON_DeleteItemFromObjectCaseSensitive(document->json, extension);
+    cJSON_AddStringToObject(document->json, extension, interned);
+    document->dirty = true;
+    add_mapping(extension, interned);
+
+    if (replacing) {
+        batch->replaced++;
+    } else {
+        batch->added++;
+    }
+    return 0;
+}
+
+int config_batch_commit(ConfigBatch *batch) {
+    int failures = 0;
+
+    for (size_t i = 0; i < batch->count; i++) {
+        CategoryDocument *document = &batch->documents[i];
+        if (!document->dirty) continue;
+
+        char *config_path = construct_config_path(batch->config_folder, document->category);
+        if (config_path == NULL) {
+            exit(1);
+        }
+
+        if (cJSON_GetArraySize(document->json) == 0) {
+            if (remove(config_path) == 0) {
+                printf("Removed empty config file: %s\n", config_path);
+            } else if (errno != ENOENT) {
+                fprintf(stderr, "Failed to remove empty config file: %s\n", config_path);
+                failures++;
+            }
+        } else if (write_config_file(config_path, document->json) != 0) {
+            fprintf(stderr, "Failed to write updated config to %s\n", config_path);
+            failures++;
+        }
+
+        document->dirty = false;
+        free(config_path);
+    }
+
+    // The staged mappings may have touched several globs; compile them once
+    refresh_filename_rules();
+
+    if (write_rule_cache(batch->config_folder) != 0 && verbose) {
+        printf("Could not write rule cache to %s\n", batch->config_folder);
+    }
+
+    return failures == 0 ? 0 : -1;
+}
+
+void config_batch_destroy(ConfigBatch *batch) {
+    for (size_t i = 0; i < batch->count; i++) {
+        cJSON_Delete(batch->documents[i].json);
+    }
+    free(batch->documents);
+    memset(batch, 0, sizeof(*batch));
+}
+
+int parse_conflict_policy(const char *name, ConflictPolicy *policy) {
+    if (strcmp(name, "keep") == 0) {
+        *policy = CONFLICT_KEEP;
+    } else if (strcmp(name, "replace") == 0) {
+        *policy = CONFLICT_REPLACE;
+    } else if (strcmp(name, "abort") == 0) {
+        *policy = CONFLICT_ABORT;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+static int import_mapping(ConfigBatch *batch, const char *extension, const char *category) {
+    // Accept "png" as well as ".png"; the configs always store the dot.
+    // Anything else (like the "*" catch-all or a filename glob) is kept as written.
+    char normalized[MAX_EXTENSION_LENGTH];
+    bool needs_dot = isalnum((unsigned char)extension[0]) && !is_glob_pattern(extension);
+    int n = snprintf(normalized, sizeof(normalized), "%s%s", needs_dot ? "." : "", extension);
+    if (n < 0 || (size_t)n >= sizeof(normalized)) {
+        fprintf(stderr, "Extension too long: %s\n", extension);
+        return -1;
+    }
+    return config_batch_set(batch, normalized, category);
+}
+
+static char *trim(char *str) {
+    while (isspace((unsigned char)*str)) str++;
+    char *end = str + strlen(str);
+    while (end > str && isspace((unsigned char)end[-1])) end--;
+    *end = '\0';
+    return str;
+}
+
+static int import_json(ConfigBatch *batch, const char *content, const char *import_path) {
+    cJSON *json = cJSON_Parse(content);
+    if (json == NULL || !cJSON_IsObject(json)) {
+        fprintf(stderr, "JSON parse error for file: %s\n", import_path);
+        cJSON_Delete(json);
+        return -1;
+    }
+
+    // Either the config layout {".ext": "Category"} or {"Category": [".ext", ...]}
+    int result = 0;
+    cJSON *item;
+    cJSON_ArrayForEach(item, json) {
+        if (cJSON_IsString(item)) {
+            result = import_mapping(batch, item->string, item->valuestring);
+        } else if (cJSON_IsArray(item)) {
+            cJSON *extension;
+            cJSON_ArrayForEach(extension, item) {
+                if (!cJSON_IsString(extension)) {
+                    fprintf(stderr, "Expected a string extension under %s\n", item->string);
+                    result = -1;
+                    break;
+                }
+                result = import_mapping(batch, extension->valuestring, item->string);
+                if (result != 0) break;
+            }
+        } else {
+            fprintf(stderr, "Unexpected value for key %s\n", item->string);
+            result = -1;
+        }
+        if (result != 0) break;
+    }
+
+    cJSON_Delete(json);
+    return result;
+}
+
+static int import_tsv(ConfigBatch *batch, char *content) {
+    int line_number = 0;
+    char *next = content;
+
+    while (next != NULL) {
+        char *line = next;
+        next = strchr(line, '\n');
+        if (next != NULL) *next++ = '\0';
+
+        line_number++;
+        line = trim(line);
+        if (*line == '\0' || *line == '#') continue;
+
+        // Tab-separated, but a run of spaces is accepted too
+        char *separator = strchr(line, '\t');
+        if (separator == NULL) separator = strpbrk(line, " ");
+        if (separator == NULL) {
+            fprintf(stderr, "Line %d: expected EXTENSION<TAB>CATEGORY\n", line_number);
+            return -1;
+        }
+        *separator = '\0';
+
+        char *extension = trim(line);
+        char *category = trim(separator + 1);
+        if (import_mapping(batch, extension, category) != 0) {
+            fprintf(stderr, "Line %d: mapping not imported\n", line_number);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int import_rules(const char *config_folder, const char *import_path, ConflictPolicy policy) {
+    char *content = read_file_content(import_path);
+    if (content == NULL) {
+        fprintf(stderr, "Failed to read import file: %s\n", import_path);
+        return -1;
+    }
+
+    lock_config_folder(config_folder);
+    load_configs(config_folder);
+
+    ConfigBatch batch;
+    config_batch_init(&batch, config_folder, policy);
+
+    // Nothing is written unless the whole file applies cleanly
+    const char *start = content;
+    while (isspace((unsigned char)*start)) start++;
+    int result = *start == '{' ? import_json(&batch, content, import_path) : import_tsv(&batch, content);
+
+    if (result == 0) {
+        result = config_batch_commit(&batch);
+        printf("Imported %zu mappings: %zu added, %zu moved, %zu kept, %zu unchanged\n",
+               batch.added + batch.replaced + batch.kept + batch.unchanged,
+               batch.added, batch.replaced, batch.kept, batch.unchanged);
+    } else {
+        fprintf(stderr, "Import aborted, no configs were changed\n");
+    }
+
+    config_batch_destroy(&batch);
+    unlock_config_folder();
+    free(content);
+    return result;
+}
@@ -0,0 +1,49 @@
+/* =============================================================================
+   Program Name: FancyD (Fancy Directory Organizer)
+   Author: Nicholas D. Redmond (3A3YN1CKY)
+   Date: 8/13/2024
+   Description: Simple program to organize files in a directory.
+   ============================================================================= */
+
+#ifndef CONFIG_BATCH_H
+#define CONFIG_BATCH_H
+
+#include <fancy.h>
+
+// What to do when a mapping names an extension that already has a category
+typedef enum {
+    CONFLICT_KEEP,      // leave the existing mapping alone
+    CONFLICT_REPLACE,   // move the extension to the new category
+    CONFLICT_ABORT      // stop and write nothing
+} ConflictPolicy;
+
+typedef struct {
+    const char *category;
+    cJSON *json;
+    bool dirty;
+} CategoryDocument;
+
+// A set of mapping changes applied to the loaded rules in one pass.
+// Each touched *_config.json is read at most once and written at most once,
+// when the batch is committed.
+typedef struct ConfigBatch {
+    const char *config_folder;
+    ConflictPolicy policy;
+    CategoryDocument *documents;
+    size_t count;
+    size_t capacity;
+    size_t added;
+    size_t replaced;
+    size_t kept;
+    size_t unchanged;
+} ConfigBatch;
+
+void config_batch_init(ConfigBatch *batch, const char *config_folder, ConflictPolicy policy);
+int config_batch_set(ConfigBatch *batch, const char *extension, const char *category);
+int config_batch_commit(ConfigBatch *batch);
+void config_batch_destroy(ConfigBatch *batch);
+
+int parse_conflict_policy(const char *name, ConflictPolicy *policy);
+int import_rules(const char *config_folder, const char *import_path, ConflictPolicy policy);
+
+#endif // CONFIG_BATCH_H
@@ -0,0 +1,59 @@
+/* =============================================================================
+   Program Name: FancyD (Fancy Directory Organizer)
+   Author: Nicholas D. Redmond (3A3YN1CKY)
+   Date: 8/13/2024
+   Description: Simple program to organize files in a directory.
+   ============================================================================= */
+
+#include <config_writer.h>
+
+void write_json_string(FILE *file, const char *str) {
+    // Same escapes as cJSON, so either writer's output reads back the same
+    putc('"', file);
+    for (const unsigned char *p = (const unsigned char *)str; *p; p++) {
+        switch (*p) {
+            case '"':  fputs("\\\"", file); break;
+            case '\\': fputs("\\\\", file); break;
+            case '\b': fputs("\\b", file); break;
+            case '\f': fputs("\\f", file); break;
+            case '\n': fputs("\\n", file); break;
+            case '\r': fputs("\\r", file); break;
+            case '\t': fputs("\\t", file); break;
+            default:
+                if (*p < 0x20) {
+                    fprintf(file, "\\u%04x", *p);
+                } else {
+                    putc(*p, file);
+                }
+        }
+    }
+    putc('"', file);
+}
+
+int write_config_json(FILE *file, const cJSON *json, bool compact) {
+    putc('{', file);
+    if (!compact) putc('\n', file);
+
+    const cJSON *item;
+    cJSON_ArrayForEach(item, json) {
+        if (!compact) putc('\t', file);
+        write_json_string(file, item->string);
+        fputs(compact ? ":" : ":\t", file);
+
+        if (cJSON_IsString(item)) {
+            write_json_string(file, item->valuestring);
+        } else {
+            // Configs only hold strings; anything else is passed through as-is
+            char *value = cJSON_PrintUnformatted(item);
+            if (value == NULL) return -1;
+            fputs(value, file);
+            free(value);
+        }
+
+        if (item->next != NULL) putc(',', file);
+        if (!compact) putc('\n', file);
+    }
+
+    putc('}', file);
+    return ferror(file) ? -1 : 0;
+}
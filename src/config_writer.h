@@ -0,0 +1,20 @@
+/* =============================================================================
+   Program Name: FancyD (Fancy Directory Organizer)
+   Author: Nicholas D. Redmond (3A3YN1CKY)
+   Date: 8/13/2024
+   Description: Simple program to organize files in a directory.
+   ============================================================================= */
+
+#ifndef CONFIG_WRITER_H
+#define CONFIG_WRITER_H
+
+#include <fancy.h>
+
+// Writes a category config straight into a stdio stream, one key/value
+// pair at a time, without building the whole document as a string first.
+// The default layout is byte-for-byte what cJSON_Print produces for a flat
+// object; compact mode drops all whitespace. Returns 0, or -1 on a write error.
+int write_config_json(FILE *file, const cJSON *json, bool compact);
+void write_json_string(FILE *file, const char *str);
+
+#endif // CONFIG_WRITER_H
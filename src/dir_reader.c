@@ -0,0 +1,144 @@
+/* =============================================================================
+   Program Name: FancyD (Fancy Directory Organizer)
+   Author: Nicholas D. Redmond (3A3YN1CKY)
+   Date: 8/13/2024
+   Description: Simple program to organize files in a directory.
+   ============================================================================= */
+
+#include "dir_reader.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+
+// Layout of the records returned by getdents64. glibc only exposes a
+// wrapper from 2.30 on, so go through syscall() directly.
+struct linux_dirent64 {
+    unsigned long long d_ino;
+    long long d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+#endif
+
+size_t dir_buffer_size = DEFAULT_DIR_BUFFER_SIZE;
+
+int dir_reader_open(DirReader *reader, const char *directory, size_t buffer_size) {
+    int fd = open(directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1) {
+        memset(reader, 0, sizeof(*reader));
+        reader->fd = -1;
+        return -1;
+    }
+
+    if (dir_reader_open_fd(reader, fd, buffer_size) != 0) {
+        close(fd);
+        return -1;
+    }
+    reader->owns_fd = true;
+    return 0;
+}
+
+// Reads through an fd the caller keeps ownership of. The fd's directory
+// offset advances, but that doesn't matter to the *at() calls that
+// usually share it.
+int dir_reader_open_fd(DirReader *reader, int dir_fd, size_t buffer_size) {
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = dir_fd;
+
+#ifdef __linux__
+    reader->buffer = malloc(buffer_size);
+    if (reader->buffer == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        reader->fd = -1;
+        return -1;
+    }
+    reader->buffer_size = buffer_size;
+#else
+    (void)buffer_size;
+    // fdopendir takes the fd over, so hand it a duplicate
+    int fd = dup(dir_fd);
+    reader->dir = fd == -1 ? NULL : fdopendir(fd);
+    if (reader->dir == NULL) {
+        if (fd != -1) close(fd);
+        reader->fd = -1;
+        return -1;
+    }
+#endif
+
+    return 0;
+}
+
+static DirEntry* reserve_entry(DirReader *reader, size_t count) {
+    if (count == reader->entries_capacity) {
+        size_t capacity = reader->entries_capacity ? reader->entries_capacity * 2 : 256;
+        DirEntry *entries = realloc(reader->entries, sizeof(DirEntry) * capacity);
+        if (entries == NULL) {
+            fprintf(stderr, "Memory allocation failed\n");
+            return NULL;
+        }
+        reader->entries = entries;
+        reader->entries_capacity = capacity;
+    }
+    return &reader->entries[count];
+}
+
+long dir_reader_next_batch(DirReader *reader, DirEntry **entries) {
+    size_t count = 0;
+
+#ifdef __linux__
+    long nread = syscall(SYS_getdents64, reader->fd, reader->buffer, reader->buffer_size);
+    if (nread <= 0) {
+        return nread;
+    }
+
+    for (long pos = 0; pos < nread; ) {
+        struct linux_dirent64 *record = (struct linux_dirent64 *)(reader->buffer + pos);
+        DirEntry *entry = reserve_entry(reader, count);
+        if (entry == NULL) return -1;
+
+        entry->name = record->d_name;
+        entry->d_type = record->d_type;
+        entry->d_ino = (ino_t)record->d_ino;
+        count++;
+        pos += record->d_reclen;
+    }
+#else
+    // Portable fallback: drain readdir one entry at a time, copying nothing
+    // since the names stay valid until the next readdir on most platforms.
+    struct dirent *record;
+    errno = 0;
+    if ((record = readdir(reader->dir)) != NULL) {
+        DirEntry *entry = reserve_entry(reader, count);
+        if (entry == NULL) return -1;
+
+        entry->name = record->d_name;
+        entry->d_type = record->d_type;
+        entry->d_ino = record->d_ino;
+        count++;
+    } else if (errno != 0) {
+        return -1;
+    }
+#endif
+
+    *entries = reader->entries;
+    return (long)count;
+}
+
+void dir_reader_close(DirReader *reader) {
+#ifndef __linux__
+    if (reader->dir != NULL) {
+        closedir(reader->dir);
+    }
+#endif
+    if (reader->owns_fd && reader->fd != -1) {
+        close(reader->fd);
+    }
+    free(reader->buffer);
+    free(reader->entries);
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = -1;
+}
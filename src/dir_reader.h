@@ -0,0 +1,51 @@
+/* =============================================================================
+   Program Name: FancyD (Fancy Directory Organizer)
+   Author: Nicholas D. Redmond (3A3YN1CKY)
+   Date: 8/13/2024
+   Description: Simple program to organize files in a directory.
+   ============================================================================= */
+
+#ifndef DIR_READER_H
+#define DIR_READER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <dirent.h>
+#include <sys/types.h>
+
+#define DEFAULT_DIR_BUFFER_SIZE (1024 * 1024)
+#define MIN_DIR_BUFFER_SIZE (64 * 1024)
+#define MAX_DIR_BUFFER_SIZE (64 * 1024 * 1024)
+
+typedef struct {
+    const char *name;
+    unsigned char d_type;
+    ino_t d_ino;
+} DirEntry;
+
+// Reads a directory in large getdents64 chunks. Each call to
+// dir_reader_next_batch hands back every entry from one kernel read;
+// the names point into the reader's buffer and stay valid until the
+// next call.
+typedef struct {
+    int fd;
+    bool owns_fd;
+    char *buffer;
+    size_t buffer_size;
+    DirEntry *entries;
+    size_t entries_capacity;
+#ifndef __linux__
+    DIR *dir;
+#endif
+} DirReader;
+
+int dir_reader_open(DirReader *reader, const char *directory, size_t buffer_size);
+int dir_reader_open_fd(DirReader *reader, int dir_fd, size_t buffer_size);
+long dir_reader_next_batch(DirReader *reader, DirEntry **entries);
+void dir_reader_close(DirReader *reader);
+
+extern size_t dir_buffer_size;
+
+#endif // DIR_READER_H
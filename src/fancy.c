@@ -7,13 +7,64 @@
 
 #include <fancy.h>
 #include <color_utils.h>
+#include <dir_reader.h>
+#include <move_pool.h>
+#include <uring_backend.h>
+#include <category_cache.h>
+#include <xdev_move.h>
+#include <tree_walk.h>
+#include <rule_cache.h>
+#include <config_batch.h>
+#include <config_writer.h>
+#include <suffix_trie.h>
+#include <glob_rules.h>
+#include <scan_state.h>
+#include <move_plan.h>
+#include <collision.h>
+#include <sniff.h>
 
 ExtensionMapping *mappings = NULL;
 int mapping_count = 0;
+int mapping_capacity = 0;
 int verbose = 0;
+int jobs = 0;                   // 0 until --jobs is given: one per CPU for trees, serial otherwise
+bool use_io_uring = false;
+bool recursive = false;
+int max_depth = -1;
+bool compact_configs = false;
+bool sniff_content = false;
+bool use_scan_state = false;
+
+// Every extension and category string lives in this arena and is released
+// in one go by free_existing_mappings. Category names are interned so each
+// one is stored once no matter how many extensions point at it.
+ArenaBlock *string_arena = NULL;
+char **category_table = NULL;
+size_t category_capacity = 0;
+int category_count = 0;
+
+// Open-addressing index over mappings[], keyed by case-folded extension.
+// Slots hold positions in mappings[] or -1 when empty.
+int *extension_index = NULL;
+size_t index_capacity = 0;
+
+// Mappings whose extension was already indexed by an earlier mapping; they
+// only need looking for when the visible one is removed
+static int shadowed_mapping_count = 0;
+
+// Filenames are classified through these; the hash index above is what
+// config edits use to find and replace individual mappings
+SuffixTrie extension_trie;
+GlobMatcher glob_rules;
+
+// Set when a glob or the index changed; bulk loads compile once at the end
+static bool filename_rules_dirty = false;
 
 bool is_config_file(const char *filename) {
-    return strstr(filename, "_config.json") != NULL;
+    // A suffix match, so "Images_config.json.123.tmp" mid-write doesn't count
+    static const char suffix[] = "_config.json";
+    size_t length = strlen(filename);
+    return length >= sizeof(suffix) - 1 && strcmp(filename + length - (sizeof(suffix) - 1), suffix) == 0;
 }
 
 void print_usage(const char *program_name) {
@@ -25,33 +76,114 @@ void print_usage(const char *program_name) {
     printf("  -d, --default       Create default categories\n");
     printf("  -r, --reset         Reset categories\n");
     printf("  -v, --verbose       Enable verbose output\n");
+    printf("  -j, --jobs N        Move files with N worker threads\n");
+    printf("  -u, --io-uring      Batch moves through io_uring when available\n");
+    printf("  -R, --recursive     Also organize every subdirectory\n");
+    printf("  -D, --max-depth N   With --recursive, stop N levels below DIRECTORY\n");
+    printf("  -B, --dir-buffer KIB  Directory read buffer size in KiB (default 1024)\n");
+    printf("  -i, --import FILE   Add every mapping in FILE (EXT<TAB>CATEGORY lines or JSON)\n");
+    printf("  -C, --on-conflict P With --import, keep, replace or abort on existing extensions\n");
+    printf("  -c, --compact       Write config files without indentation\n");
+    printf("  -s, --sniff         Recognize files without an extension by their contents\n");
+    printf("  -S, --state         Remember skipped files and skip unchanged directories\n");
+    printf("  -w, --watch DIR     Keep running and sort files as they arrive in DIR\n");
+    printf("  -n, --dry-run       Print the moves as a plan instead of making them\n");
+    printf("  -P, --plan FILE     Like --dry-run, but write the plan to FILE\n");
+    printf("  -A, --apply FILE    Make the moves listed in a saved plan\n");
+    printf("  -J, --journal FILE  Record every move in FILE so it can be undone\n");
+    printf("  -U, --undo FILE     Put back every file moved in a journal\n");
+    printf("  -x, --on-collision P  When a category already has the name: suffix, skip or compare\n");
 }
 
 char* read_file_content(const char *filepath) {
-    FILE *file = fopen(filepath, "r");
-    if (file == NULL) {
+    int fd = open(filepath, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
         // fprintf(stderr, "Unable to open file: %s\n", filepath); // Use for debug
         return NULL;
     }
 
-    fseek(file, 0, SEEK_END);
-    long fsize = ftell(file);
-    fseek(file, 0, SEEK_SET);
-
-    char *content = malloc(fsize + 1);
+    // Read until EOF rather than trusting the size up front, so pipes and
+    // short reads both come back complete
+    size_t capacity = 4096;
+    size_t length = 0;
+    char *content = malloc(capacity);
     if (content == NULL) {
         fprintf(stderr, "Memory allocation failed\n");
-        fclose(file);
+        close(fd);
         return NULL;
     }
 
-    fread(content, 1, fsize, file);
-    fclose(file);
-    content[fsize] = 0;
+    for (;;) {
+        if (length + 1 == capacity) {
+            char *grown = realloc(content, capacity * 2);
+            if (grown == NULL) {
+                fprintf(stderr, "Memory allocation failed\n");
+                free(content);
+                close(fd);
+                return NULL;
+            }
+            content = grown;
+            capacity *= 2;
+        }
+
+        ssize_t n = read(fd, content + length, capacity - length - 1);
+        if (n == 0) break;
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            free(content);
+            close(fd);
+            return NULL;
+        }
+        length += n;
+    }
+
+    close(fd);
+    content[length] = 0;
 
     return content;
 }
 
+int parse_json_file(const char *filepath, cJSON **json) {
+    *json = NULL;
+
+    int fd = open(filepath, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    if (!S_ISREG(st.st_mode)) {
+        // Pipes and the like can't be mapped; stream them instead
+        close(fd);
+        char *content = read_file_content(filepath);
+        if (content == NULL) return -1;
+        *json = cJSON_Parse(content);
+        free(content);
+        return 0;
+    }
+
+    if (st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+
+    // Parse straight out of the page cache instead of copying into a buffer
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return -1;
+    }
+
+    *json = cJSON_ParseWithLength(data, st.st_size);
+    munmap(data, st.st_size);
+    return 0;
+}
+
 void list_extensions(const char *config_folder) {
     DIR *dir;
     struct dirent *ent;
@@ -71,11 +203,8 @@ void list_extensions(const char *config_folder) {
     
         snprintf(file_path, sizeof(file_path), "%s/%s", config_folder, ent->d_name);
         
-        char *json_str = read_file_content(file_path);
-        if (json_str == NULL) continue;
-        
-        cJSON *json = cJSON_Parse(json_str);
-        free(json_str);
+        cJSON *json;
+        if (parse_json_file(file_path, &json) != 0) continue;
 
         if (json == NULL) {
             fprintf(stderr, "JSON parse error for file: %s\n", file_path);
@@ -118,12 +247,9 @@ char* construct_file_path(const char *folder, const char *filename) {
     return file_path;
 }
 
-void process_default_config(const char *config_folder, const char *file_path) {
-    char *json_str = read_file_content(file_path);
-    if (json_str == NULL) return;
-
-    cJSON *json = cJSON_Parse(json_str);
-    free(json_str);
+void process_default_config(struct ConfigBatch *batch, const char *file_path) {
+    cJSON *json;
+    if (parse_json_file(file_path, &json) != 0) return;
 
     if (json == NULL) {
         fprintf(stderr, "Error parsing JSON in file: %s\n", file_path);
@@ -132,10 +258,10 @@ void process_default_config(const char *config_folder, const char *file_path) {
 
     cJSON *extension;
     cJSON_ArrayForEach(extension, json) {
-        if (check_duplicate_extension(config_folder, extension->string, extension->valuestring) == 0) {
-            add_extension(config_folder, extension->string, extension->valuestring);
-        } else {
-            printf("Skipping conflicting extension %s\n", extension->string);
+        if (!cJSON_IsString(extension)) continue;
+
+        if (config_batch_set(batch, extension->string, extension->valuestring) != 0) {
+            printf("Skipping invalid default mapping %s\n", extension->string);
         }
     }
 
@@ -143,21 +269,288 @@ void process_default_config(const char *config_folder, const char *file_path) {
 }
 
 void free_existing_mappings() {
-    for (int i = 0; i < mapping_count; i++) {
-        free(mappings[i].extension);
-        free(mappings[i].category);
+    ArenaBlock *block = string_arena;
+    while (block != NULL) {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
     }
+    string_arena = NULL;
+
     free(mappings);
+    mappings = NULL;
+    mapping_count = 0;
+    mapping_capacity = 0;
+
+    free(category_table);
+    category_table = NULL;
+    category_capacity = 0;
+    category_count = 0;
+
+    if (!index_is_mapped) {
+        free(extension_index);
+    }
+    extension_index = NULL;
+    index_capacity = 0;
+
+    suffix_trie_destroy(&extension_trie);
+    glob_matcher_destroy(&glob_rules);
+    release_rule_cache();
 }
 
 void initialize_mappings() {
-    mappings = malloc(sizeof(ExtensionMapping) * MAX_EXTENSIONS);
-    if (!mappings) {
+    mappings = NULL;
+    mapping_count = 0;
+    mapping_capacity = 0;
+    grow_mappings(INITIAL_MAPPING_CAPACITY);
+
+    category_table = calloc(INITIAL_CATEGORY_CAPACITY, sizeof(char *));
+    if (!category_table) {
         fprintf(stderr, "Memory allocation failed\n");
         exit(1);
     }
-    memset(mappings, 0, sizeof(ExtensionMapping) * MAX_EXTENSIONS);
-    mapping_count = 0;
+    category_capacity = INITIAL_CATEGORY_CAPACITY;
+    category_count = 0;
+
+    suffix_trie_init(&extension_trie);
+    glob_matcher_init(&glob_rules);
+    resize_extension_index(INITIAL_INDEX_CAPACITY);
+}
+
+void grow_mappings(int capacity) {
+    ExtensionMapping *grown = realloc(mappings, sizeof(ExtensionMapping) * capacity);
+    if (!grown) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    mappings = grown;
+    mapping_capacity = capacity;
+}
+
+char* arena_strdup(const char *str) {
+    size_t len = strlen(str) + 1;
+
+    if (string_arena == NULL || string_arena->size - string_arena->used < len) {
+        // Oversized strings get a block of their own
+        size_t size = len > ARENA_BLOCK_SIZE ? len : ARENA_BLOCK_SIZE;
+        ArenaBlock *block = malloc(sizeof(ArenaBlock) + size);
+        if (!block) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        block->size = size;
+        block->used = 0;
+        block->next = string_arena;
+        string_arena = block;
+    }
+
+    char *copy = string_arena->data + string_arena->used;
+    memcpy(copy, str, len);
+    string_arena->used += len;
+    return copy;
+}
+
+char* intern_category(const char *category) {
+    return insert_category(category, false);
+}
+
+char* insert_category(const char *category, bool borrow) {
+    // Category names are case-sensitive; the case-folded hash is still
+    // consistent for exact matches, it just collides a little more.
+    // Borrowed strings (e.g. from the mapped rule cache) are stored as-is.
+    size_t mask = category_capacity - 1;
+    size_t slot = hash_extension(category) & mask;
+    while (category_table[slot] != NULL) {
+        if (strcmp(category_table[slot], category) == 0) return category_table[slot];
+        slot = (slot + 1) & mask;
+    }
+
+    char *interned = borrow ? (char *)category : arena_strdup(category);
+    category_table[slot] = interned;
+    category_count++;
+
+    if ((size_t)category_count * 2 > category_capacity) {
+        size_t capacity = category_capacity * 2;
+        char **table = calloc(capacity, sizeof(char *));
+        if (!table) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        for (size_t i = 0; i < category_capacity; i++) {
+            if (category_table[i] == NULL) continue;
+            size_t pos = hash_extension(category_table[i]) & (capacity - 1);
+            while (table[pos] != NULL) pos = (pos + 1) & (capacity - 1);
+            table[pos] = category_table[i];
+        }
+        free(category_table);
+        category_table = table;
+        category_capacity = capacity;
+    }
+
+    return interned;
+}
+
+bool is_plain_name(const char *name) {
+    // A single path component: categories become directories and config
+    // file names, and plan entries must not point outside their directory
+    return name[0] != '\0' && strchr(name, '/') == NULL &&
+           strcmp(name, ".") != 0 && strcmp(name, "..") != 0;
+}
+
+bool is_category_name(const char *name) {
+    if (category_table == NULL) return false;
+
+    size_t mask = category_capacity - 1;
+    for (size_t slot = hash_extension(name) & mask; category_table[slot] != NULL; slot = (slot + 1) & mask) {
+        if (strcmp(category_table[slot], name) == 0) return true;
+    }
+    return false;
+}
+
+unsigned long hash_extension(const char *extension) {
+    // FNV-1a over the lowercased bytes so lookups match strcasecmp semantics
+    unsigned long hash = 2166136261UL;
+    for (const unsigned char *p = (const unsigned char *)extension; *p; p++) {
+        hash ^= (unsigned char)tolower(*p);
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+int find_mapping_index(const char *extension) {
+    if (extension_index == NULL) return -1;
+
+    size_t mask = index_capacity - 1;
+    for (size_t slot = hash_extension(extension) & mask; ; slot = (slot + 1) & mask) {
+        int idx = extension_index[slot];
+        if (idx < 0) return -1;
+        if (strcasecmp(mappings[idx].extension, extension) == 0) return idx;
+    }
+}
+
+void index_mapping(int mapping_idx) {
+    size_t mask = index_capacity - 1;
+    size_t slot = hash_extension(mappings[mapping_idx].extension) & mask;
+    while (extension_index[slot] >= 0) {
+        // First mapping wins, same as the old linear scan
+        if (strcasecmp(mappings[extension_index[slot]].extension, mappings[mapping_idx].extension) == 0) {
+            shadowed_mapping_count++;
+            return;
+        }
+        slot = (slot + 1) & mask;
+    }
+    extension_index[slot] = mapping_idx;
+}
+
+size_t find_index_slot(int mapping_idx) {
+    size_t mask = index_capacity - 1;
+    size_t slot = hash_extension(mappings[mapping_idx].extension) & mask;
+    while (extension_index[slot] != mapping_idx) slot = (slot + 1) & mask;
+    return slot;
+}
+
+void unindex_slot(size_t slot) {
+    // Backward-shift deletion keeps every probe chain unbroken without tombstones
+    size_t mask = index_capacity - 1;
+    size_t hole = slot;
+    for (size_t next = (slot + 1) & mask; extension_index[next] >= 0; next = (next + 1) & mask) {
+        size_t home = hash_extension(mappings[extension_index[next]].extension) & mask;
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            extension_index[hole] = extension_index[next];
+            hole = next;
+        }
+    }
+    extension_index[hole] = -1;
+}
+
+bool remove_mapping(const char *extension) {
+    int idx = find_mapping_index(extension);
+    if (idx < 0) return false;
+
+    // A mapped index is read-only, so detach from the rule cache first
+    if (index_is_mapped) {
+        resize_extension_index(index_capacity);
+    }
+
+    unindex_slot(find_index_slot(idx));
+
+    // Fill the gap with the last mapping so mappings[] stays dense
+    int last = mapping_count - 1;
+    if (idx != last) {
+        size_t slot = SIZE_MAX;
+        if (find_mapping_index(mappings[last].extension) == last) {
+            slot = find_index_slot(last);
+        }
+        mappings[idx] = mappings[last];
+        if (slot != SIZE_MAX) extension_index[slot] = idx;
+    }
+    mapping_count--;
+
+    // Another config may list the same extension; it becomes visible now
+    if (shadowed_mapping_count > 0) {
+        for (int i = 0; i < mapping_count; i++) {
+            if (strcasecmp(mappings[i].extension, extension) == 0) {
+                shadowed_mapping_count--;
+                index_mapping(i);
+                break;
+            }
+        }
+    }
+
+    // Patterns are compiled together, so changing one means recompiling
+    if (is_glob_pattern(extension)) {
+        filename_rules_dirty = true;
+    } else {
+        int visible = find_mapping_index(extension);
+        suffix_trie_set(&extension_trie, extension, visible >= 0 ? mappings[visible].category : NULL);
+    }
+    return true;
+}
+
+void resize_extension_index(size_t capacity) {
+    int *slots = malloc(sizeof(int) * capacity);
+    if (!slots) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    memset(slots, 0xff, sizeof(int) * capacity);
+
+    // A mapped index is read-only; replacing it is how we detach from the cache
+    if (!index_is_mapped) {
+        free(extension_index);
+    }
+    index_is_mapped = false;
+    extension_index = slots;
+    index_capacity = capacity;
+    shadowed_mapping_count = 0;
+
+    for (int i = 0; i < mapping_count; i++) {
+        index_mapping(i);
+    }
+
+    // Which of several duplicate mappings is visible can change with the
+    // rebuild, so the filename rules follow the index
+    filename_rules_dirty = true;
+}
+
+void rebuild_filename_rules() {
+    suffix_trie_destroy(&extension_trie);
+    glob_matcher_destroy(&glob_rules);
+    for (int i = 0; i < mapping_count; i++) {
+        if (find_mapping_index(mappings[i].extension) != i) continue;
+
+        if (is_glob_pattern(mappings[i].extension)) {
+            glob_matcher_add(&glob_rules, mappings[i].extension, mappings[i].category);
+        } else {
+            suffix_trie_set(&extension_trie, mappings[i].extension, mappings[i].category);
+        }
+    }
+    glob_matcher_compile(&glob_rules);
+    filename_rules_dirty = false;
+}
+
+void refresh_filename_rules() {
+    if (filename_rules_dirty) rebuild_filename_rules();
 }
 
 void handle_missing_configs(const char *config_folder) {
@@ -172,11 +565,8 @@ void handle_missing_configs(const char *config_folder) {
 }
 
 void process_config_file(const char *file_path) {
-    char *json_str = read_file_content(file_path);
-    if (json_str == NULL) return;
-
-    cJSON *json = cJSON_Parse(json_str);
-    free(json_str);
+    cJSON *json;
+    if (parse_json_file(file_path, &json) != 0) return;
 
     if (json == NULL) {
         handle_json_parse_error(file_path);
@@ -194,63 +584,170 @@ void handle_json_parse_error(const char *file_path) {
 void add_mappings_from_json(cJSON *json) {
     cJSON *extension;
     cJSON_ArrayForEach(extension, json) {
-        if (mapping_count >= MAX_EXTENSIONS) {
-            fprintf(stderr, "Too many extensions, increase MAX_EXTENSIONS\n");
-            break;
-        }
+        if (!cJSON_IsString(extension)) continue;
 
         add_mapping(extension->string, extension->valuestring);
     }
 }
 
 void add_mapping(const char *extension, const char *category) {
-    mappings[mapping_count].extension = strdup(extension);
-    mappings[mapping_count].category = strdup(category);
+    if (mapping_count == mapping_capacity) {
+        grow_mappings(mapping_capacity * 2);
+    }
+
+    mappings[mapping_count].extension = arena_strdup(extension);
+    mappings[mapping_count].category = intern_category(category);
     mapping_count++;
+
+    // Keep the load factor under 1/2 so probe chains stay short. An index
+    // still mapped from the rule cache is read-only, so copy it first.
+    if ((size_t)mapping_count * 2 > index_capacity) {
+        resize_extension_index(index_capacity * 2);
+    } else if (index_is_mapped) {
+        resize_extension_index(index_capacity);
+    } else {
+        index_mapping(mapping_count - 1);
+    }
+
+    if (is_glob_pattern(extension)) {
+        filename_rules_dirty = true;
+    } else if (find_mapping_index(extension) == mapping_count - 1) {
+        suffix_trie_set(&extension_trie, extension, mappings[mapping_count - 1].category);
+    }
 }
 
 bool check_for_uncategorized_files(const char *directory) {
-    DIR *dir = opendir(directory);
-    if (dir == NULL) {
+    FileBatch batch;
+    if (!scan_directory(directory, &batch)) {
+        return false;
+    }
+
+    bool uncategorized_files_found = batch.has_uncategorized;
+    free_file_batch(&batch);
+
+    if (uncategorized_files_found) {
+        return prompt_for_misc_category();
+    }
+
+    return false;
+}
+
+bool scan_directory(const char *directory, FileBatch *batch) {
+    int dir_fd = open(directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd == -1) {
+        memset(batch, 0, sizeof(*batch));
         fprintf(stderr, "Unable to open directory: %s\n", directory);
         return false;
     }
 
-    struct dirent *entry;
-    bool uncategorized_files_found = false;
+    bool result = scan_directory_at(dir_fd, directory, batch);
+    close(dir_fd);
+    return result;
+}
+
+bool scan_directory_at(int dir_fd, const char *directory, FileBatch *batch) {
+    return scan_directory_incremental(dir_fd, directory, batch, NULL);
+}
 
-    while ((entry = readdir(dir)) != NULL) {
-        if (is_special_directory(entry->d_name)) continue;
+bool scan_directory_incremental(int dir_fd, const char *directory, FileBatch *batch, struct ScanState *state) {
+    memset(batch, 0, sizeof(*batch));
+
+    DirReader reader;
+    if (dir_reader_open_fd(&reader, dir_fd, dir_buffer_size) != 0) {
+        fprintf(stderr, "Unable to read directory: %s\n", directory);
+        return false;
+    }
 
-        char file_path[MAX_PATH];
-        snprintf(file_path, sizeof(file_path), "%s/%s", directory, entry->d_name);
+    DirEntry *entries;
+    long count;
+    while ((count = dir_reader_next_batch(&reader, &entries)) > 0) {
+        for (long i = 0; i < count; i++) {
+            if (is_special_directory(entries[i].name)) continue;
+
+            // Left in place last time, unchanged since, and the rules are the
+            // same, so it is still uncategorized without classifying it again.
+            // It stays in the batch so a yes to misc this time still takes it.
+            if (state != NULL && scan_state_skipped_before(state, dir_fd, entries[i].name)) {
+                add_file_to_batch(batch, entries[i].name, NULL);
+                continue;
+            }
 
-        if (!is_regular_file(file_path)) continue;
+            if (!is_regular_entry(dir_fd, entries[i].name, entries[i].d_type)) continue;
 
-        char *extension = get_file_extension(entry->d_name);
-        if (extension && !get_category_for_extension(extension)) {
-            uncategorized_files_found = true;
-            break;
+            const char *category = classify_file(dir_fd, entries[i].name);
+            add_file_to_batch(batch, entries[i].name, category);
         }
     }
 
-    closedir(dir);
+    if (count < 0) {
+        fprintf(stderr, "Error reading directory %s: %s\n", directory, strerror(errno));
+    }
 
-    if (uncategorized_files_found) {
-        return prompt_for_misc_category();
+    dir_reader_close(&reader);
+    return true;
+}
+
+bool is_regular_entry(int dir_fd, const char *name, unsigned char d_type) {
+    if (d_type != DT_UNKNOWN) {
+        return d_type == DT_REG;
     }
 
-    return false;
+    // Some filesystems don't fill in d_type, so ask the inode directly
+    return is_regular_file(dir_fd, name);
+}
+
+void add_file_to_batch(FileBatch *batch, const char *name, const char *category) {
+    size_t len = strlen(name) + 1;
+
+    if (batch->count == batch->capacity) {
+        size_t capacity = batch->capacity ? batch->capacity * 2 : INITIAL_BATCH_CAPACITY;
+        FileEntry *entries = realloc(batch->entries, sizeof(FileEntry) * capacity);
+        if (!entries) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        batch->entries = entries;
+        batch->capacity = capacity;
+    }
+
+    if (batch->names_used + len > batch->names_size) {
+        size_t size = batch->names_size ? batch->names_size * 2 : INITIAL_BATCH_CAPACITY * 16;
+        while (size < batch->names_used + len) size *= 2;
+        char *names = realloc(batch->names, size);
+        if (!names) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        batch->names = names;
+        batch->names_size = size;
+    }
+
+    // Names are stored as offsets since the buffer may move as it grows
+    memcpy(batch->names + batch->names_used, name, len);
+    batch->entries[batch->count].name_offset = batch->names_used;
+    batch->entries[batch->count].category = category;
+    batch->names_used += len;
+    batch->count++;
+
+    if (category == NULL) {
+        batch->has_uncategorized = true;
+    }
+}
+
+void free_file_batch(FileBatch *batch) {
+    free(batch->entries);
+    free(batch->names);
+    memset(batch, 0, sizeof(*batch));
 }
 
 bool is_special_directory(const char *name) {
     return strcmp(name, ".") == 0 || strcmp(name, "..") == 0;
 }
 
-bool is_regular_file(const char *path) {
+bool is_regular_file(int dir_fd, const char *name) {
     struct stat path_stat;
-    if (lstat(path, &path_stat) != 0) {
-        fprintf(stderr, "Unable to get file stats for %s\n", path);
+    if (fstatat(dir_fd, name, &path_stat, AT_SYMLINK_NOFOLLOW) != 0) {
+        fprintf(stderr, "Unable to get file stats for %s\n", name);
         return false;
     }
     return S_ISREG(path_stat.st_mode);
@@ -259,7 +756,7 @@ bool is_regular_file(const char *path) {
 char* get_file_extension(const char *filename) {
     char *dot = strrchr(filename, '.');
     if(!dot || dot == filename) return "";
-    static char extension[256];  // Static buffer to store the extension
+    static _Thread_local char extension[256];  // Per-thread buffer so walker threads don't clobber each other
     snprintf(extension, sizeof(extension), ".%s", dot + 1);  // Add leading dot
     return extension;
 }
@@ -271,15 +768,37 @@ char* get_category_for_extension(const char *extension) {
     if (extension[0] != '.') {
         snprintf(full_extension, sizeof(full_extension), ".%s", extension);
     } else {
-        strncpy(full_extension, extension, sizeof(full_extension));
+        snprintf(full_extension, sizeof(full_extension), "%s", extension);
     }
     
-    for (int i = 0; i < mapping_count; i++) {
-        if (strcasecmp(mappings[i].extension, full_extension) == 0) {
-            return mappings[i].category;
-        }
+    int idx = find_mapping_index(full_extension);
+    return idx >= 0 ? mappings[idx].category : NULL;
+}
+
+const char* match_filename_rules(const char *filename) {
+    // Wildcard patterns are the most specific rules, then the longest
+    // mapped suffix (so "a.tar.gz" can differ from "a.gz")
+    const char *category = glob_matcher_match(&glob_rules, filename);
+    if (category == NULL && extension_trie.nodes != NULL) {
+        category = suffix_trie_match(&extension_trie, filename);
+    }
+    return category;
+}
+
+const char* get_category_for_filename(const char *filename) {
+    const char *category = match_filename_rules(filename);
+    return category != NULL ? category : glob_rules.catch_all;
+}
+
+const char* classify_file(int dir_fd, const char *name) {
+    const char *category = match_filename_rules(name);
+
+    // Only files with nothing to go on are opened; the "*" catch-all
+    // still gets whatever sniffing doesn't recognize
+    if (category == NULL && sniff_content && get_file_extension(name)[0] == '\0') {
+        category = sniff_file_category(dir_fd, name);
     }
-    return NULL;
+    return category != NULL ? category : glob_rules.catch_all;
 }
 
 bool prompt_for_misc_category() {
@@ -290,47 +809,88 @@ bool prompt_for_misc_category() {
 }
 
 void process_directory(const char *directory, bool handle_misc) {
-    
-    DIR *dir = opendir(directory);
-    if (dir == NULL) {
+    int dir_fd = open(directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd == -1) {
         fprintf(stderr, "Unable to open directory: %s\n", directory);
         return;
     }
 
-    struct dirent *entry;
-    while ((entry = readdir(dir)) != NULL) {
-        
-        if (is_special_directory(entry->d_name)) {
+    FileBatch batch;
+    if (scan_directory_at(dir_fd, directory, &batch)) {
+        process_file_batch(dir_fd, directory, &batch, handle_misc);
+        free_file_batch(&batch);
+    }
+    close(dir_fd);
+}
+
+MoveStats process_file_batch(int dir_fd, const char *directory, const FileBatch *batch, bool handle_misc) {
+    if (move_plan != NULL) {
+        return move_plan_record(move_plan, directory, batch, handle_misc);
+    }
+
+    if (use_io_uring) {
+        MoveStats stats = {0};
+        if (uring_move_batch(dir_fd, directory, batch, handle_misc, &stats) == 0) {
+            return stats;
+        }
+    }
+
+    if (jobs > 1) {
+        return run_move_pool(dir_fd, directory, batch, handle_misc, jobs);
+    }
+    return move_batch_serially(dir_fd, directory, batch, handle_misc);
+}
+
+MoveStats move_batch_serially(int dir_fd, const char *directory, const FileBatch *batch, bool handle_misc) {
+    MoveStats stats = {0};
+    CategoryCache cache;
+    category_cache_init(&cache, dir_fd, directory);
+
+    for (size_t i = 0; i < batch->count; i++) {
+        const char *name = batch->names + batch->entries[i].name_offset;
+        const char *category = batch->entries[i].category;
+
+        if (category == NULL && handle_misc) {
+            category = "misc";
+        }
+
+        if (category == NULL) {
+            if (verbose) {
+                printf("Skipping uncategorized file: %s\n", name);
+            }
+            stats.skipped++;
             continue;
         }
-        
-        char file_path[MAX_PATH];
-        snprintf(file_path, sizeof(file_path), "%s/%s", directory, entry->d_name);
-        
-        if (!is_regular_file(file_path)) {
+
+        CategoryDir *dir = category_cache_get(&cache, category);
+        if (dir->fd == -1) {
+            stats.failed++;
             continue;
         }
-        
-        process_file(file_path, directory, handle_misc);
+
+        move_into_category(dir_fd, directory, name, dir, &stats);
     }
 
-    closedir(dir);
+    category_cache_destroy(&cache);
+    return stats;
 }
 
-void process_file(const char *file_path, const char *directory, bool handle_misc) {
-    
-    char *extension = get_file_extension(file_path);
+void print_move_summary(const MoveStats *stats) {
+    printf("Moved %zu file(s), skipped %zu, failed %zu\n", stats->moved, stats->skipped, stats->failed);
+}
+
+void process_file(int dir_fd, const char *directory, const char *name, bool handle_misc) {
     
-    char *category = get_category_for_extension(extension);
+    const char *category = classify_file(dir_fd, name);
 
     if (category == NULL && handle_misc) {
         category = "misc";
     }
 
     if (category != NULL) {
-        move_file_to_category(file_path, directory, category);
+        move_file_to_category(dir_fd, directory, name, category);
     } else if (verbose) {
-        printf("Skipping uncategorized file: %s\n", basename((char *)file_path));
+        printf("Skipping uncategorized file: %s\n", name);
     }
 }
 
@@ -345,21 +905,20 @@ void remove_extension_from_category(const char *config_folder, const char *exten
     char config_path[MAX_PATH];
     snprintf(config_path, sizeof(config_path), "%s/%s_config.json", config_folder, category);
     
-    char *content = read_file_content(config_path);
-    if (content == NULL) {
+    cJSON *json;
+    if (parse_json_file(config_path, &json) != 0) {
         fprintf(stderr, "Failed to read config file: %s\n", config_path);
         return;
     }
 
-    cJSON *json = cJSON_Parse(content);
-    free(content);
-
     if (json == NULL) {
         fprintf(stderr, "Failed to parse JSON in file: %s\n", config_path);
         return;
     }
 
     cJSON_DeleteItemFromObject(json, extension);
+    remove_mapping(extension);
+    refresh_filename_rules();
 
     if (cJSON_GetArraySize(json) == 0) {
         // If the JSON object is now empty, delete the file
@@ -371,17 +930,12 @@ void remove_extension_from_category(const char *config_folder, const char *exten
         }
     } else {
         // Otherwise, write the updated JSON back to the file
-        char *updated_content = cJSON_Print(json);
-        FILE *file = fopen(config_path, "w");
-        if (file) {
-            fputs(updated_content, file);
-            fclose(file);
+        if (write_config_file(config_path, json) == 0) {
             printf("Removed extension %s from category %s\n", extension, category);
         } else {
             fprintf(stderr, "Failed to write updated config to %s\n", config_path);
         }
         cJSON_Delete(json);
-        free(updated_content);
     }
 }
 
@@ -396,13 +950,8 @@ char* construct_config_path(const char *config_folder, const char *category) {
 }
 
 cJSON* load_or_create_json(const char *config_path) {
-    char *content = read_file_content(config_path);
-    cJSON *json = NULL;
-    
-    if (content) {
-        json = cJSON_Parse(content);
-        free(content);
-    }
+    cJSON *json;
+    parse_json_file(config_path, &json);
     
     if (json == NULL) {
         json = cJSON_CreateObject();
@@ -416,53 +965,136 @@ void add_extension_to_json(cJSON *json, const char *extension, const char *categ
 }
 
 void save_json_to_file(cJSON *json, const char *config_path, const char *extension, const char *category) {
-    char *updated_content = cJSON_Print(json);
-    FILE *file = fopen(config_path, "w");
-    if (file) {
-        fputs(updated_content, file);
-        fclose(file);
+    if (write_config_file(config_path, json) == 0) {
         printf("Added extension %s to category %s\n", extension, category);
     } else {
         fprintf(stderr, "Failed to write updated config to %s\n", config_path);
     }
-    free(updated_content);
 }
 
-void move_file_to_category(const char *file_path, const char *directory, const char *category) {
-    char category_path[MAX_PATH];
-    char dest_path[MAX_PATH];
-    
-    snprintf(category_path, sizeof(category_path), "%s/%s", directory, category);
-    
-    if (mkdir(category_path, 0777) == -1 && errno != EEXIST) {
-        fprintf(stderr, "Failed to create category directory: %s\n", category_path);
+int write_config_file(const char *config_path, cJSON *json) {
+    // Write beside the real file, flush it to disk, then rename over it,
+    // so a crash or a concurrent reader never sees a truncated config
+    char temp_path[MAX_PATH];
+    int result = -1;
+    if (snprintf(temp_path, sizeof(temp_path), "%s.%ld.tmp", config_path, (long)getpid()) < (int)sizeof(temp_path)) {
+        FILE *file = fopen(temp_path, "w");
+        if (file) {
+            setvbuf(file, NULL, _IOFBF, CONFIG_WRITE_BUFFER_SIZE);
+            bool ok = write_config_json(file, json, compact_configs) == 0 &&
+                      fflush(file) == 0 && fsync(fileno(file)) == 0;
+            ok = fclose(file) == 0 && ok;
+            if (ok && rename(temp_path, config_path) == 0) {
+                sync_parent_directory(config_path);
+                result = 0;
+            } else {
+                remove(temp_path);
+            }
+        }
+    }
+
+    return result;
+}
+
+void sync_parent_directory(const char *path) {
+    // The rename itself is only durable once the directory is flushed
+    char directory[MAX_PATH];
+    snprintf(directory, sizeof(directory), "%s", path);
+    char *slash = strrchr(directory, '/');
+    if (slash == NULL) {
+        snprintf(directory, sizeof(directory), ".");
+    } else if (slash == directory) {
+        slash[1] = '\0';
+    } else {
+        *slash = '\0';
+    }
+
+    int fd = open(directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd != -1) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+// One lock per process: nested callers (e.g. create_default_configs reached
+// from load_configs) share it instead of blocking on their own flock
+static int config_lock_fd = -1;
+static int config_lock_depth = 0;
+
+void lock_config_folder(const char *config_folder) {
+    if (config_lock_depth++ > 0) return;
+
+    config_lock_fd = open(config_folder, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (config_lock_fd == -1) {
+        // Nothing to lock yet; whoever creates the folder will be first
         return;
     }
 
-    strncpy(dest_path, category_path, MAX_PATH - 1);
-    dest_path[MAX_PATH - 1] = '\0';
-    strncat(dest_path, "/", MAX_PATH - strlen(dest_path) - 1);
-    strncat(dest_path, basename((char *)file_path), MAX_PATH - strlen(dest_path) - 1);
+    if (flock(config_lock_fd, LOCK_EX | LOCK_NB) == -1) {
+        if (errno == EWOULDBLOCK) {
+            fprintf(stderr, "Waiting for another fancyD to finish updating %s\n", config_folder);
+        }
+        while (flock(config_lock_fd, LOCK_EX) == -1 && errno == EINTR);
+    }
+}
+
+void unlock_config_folder() {
+    if (config_lock_depth == 0 || --config_lock_depth > 0) return;
 
-    if (move_file_with_fallback(file_path, dest_path) != 0) {
-        fprintf(stderr, "Failed to move %s to %s\n", file_path, dest_path);
-    } else if (verbose) {
-        printf("Moved %s to %s\n", basename((char *)file_path), category);
+    if (config_lock_fd != -1) {
+        flock(config_lock_fd, LOCK_UN);
+        close(config_lock_fd);
+        config_lock_fd = -1;
     }
 }
 
+void insert_extension(const char *config_folder, const char *extension, const char *category) {
+    char *config_path = construct_config_path(config_folder, category);
+    if (config_path == NULL) return;
+
+    cJSON *json = load_or_create_json(config_path);
+    cJSON_DeleteItemFromObjectCaseSensitive(json, extension);
+    add_extension_to_json(json, extension, category);
+    save_json_to_file(json, config_path, extension, category);
+
+    // Replace whatever is still loaded for it: a duplicate from another
+    // config that became visible, or a mapping whose removal failed.
+    // Otherwise the stale rule would be written into the cache as current.
+    while (remove_mapping(extension));
+    add_mapping(extension, category);
+    refresh_filename_rules();
+
+    cJSON_Delete(json);
+    free(config_path);
+}
+
+int move_file_to_category(int dir_fd, const char *directory, const char *name, const char *category) {
+    // A one-entry cache, so single moves follow the same collision rules as batches
+    CategoryCache cache;
+    category_cache_init(&cache, dir_fd, directory);
+
+    MoveStats stats = {0};
+    CategoryDir *dir = category_cache_get(&cache, category);
+    if (dir->fd == -1) {
+        stats.failed++;
+    } else {
+        move_into_category(dir_fd, directory, name, dir, &stats);
+    }
+
+    category_cache_destroy(&cache);
+    return stats.failed == 0 ? 0 : -1;
+}
+
 int check_duplicate_extension(const char *config_folder, const char *extension, const char *new_category) {
-    for (int i = 0; i < mapping_count; i++) {
-        if (strcasecmp(mappings[i].extension, extension) == 0) {
-            printf("Extension %s already exists in category %s.\n", extension, mappings[i].category);
-            if (prompt_for_extension_move(extension, mappings[i].category, new_category)) {
-                remove_extension_from_category(config_folder, extension, mappings[i].category);
-                return 0;
-            }
-            return 1;
-        }
+    int i = find_mapping_index(extension);
+    if (i < 0) return 0;
+
+    printf("Extension %s already exists in category %s.\n", extension, mappings[i].category);
+    if (prompt_for_extension_move(extension, mappings[i].category, new_category)) {
+        remove_extension_from_category(config_folder, extension, mappings[i].category);
+        return 0;
     }
-    return 0;
+    return 1;
 }
 
 int create_default_configs(const char *config_folder) {
@@ -472,41 +1104,57 @@ int create_default_configs(const char *config_folder) {
         return 1;
     }
 
-    load_configs(config_folder);
-
     DIR *dir = opendir(default_config_folder);
     if (dir == NULL) {
         fprintf(stderr, "Unable to open default config folder: %s\n", default_config_folder);
         return 1;
     }
 
+    ensure_config_folder(config_folder);
+    lock_config_folder(config_folder);
+    load_configs(config_folder);
+
+    // Merge every default into the loaded rules, then write each category
+    // file once. Extensions the user already placed somewhere stay put.
+    ConfigBatch batch;
+    config_batch_init(&batch, config_folder, CONFLICT_KEEP);
+
     struct dirent *ent;
     while ((ent = readdir(dir)) != NULL) {
         if (!is_config_file(ent->d_name)) continue;
 
         char *file_path = construct_file_path(default_config_folder, ent->d_name);
-        process_default_config(config_folder, file_path);
+        process_default_config(&batch, file_path);
         free(file_path);
     }
 
     closedir(dir);
-    return 0;
+
+    int result = config_batch_commit(&batch);
+    printf("Added %zu default extensions", batch.added);
+    if (batch.kept > 0) {
+        printf(", kept %zu existing ones in their current category", batch.kept);
+    }
+    printf("\n");
+
+    config_batch_destroy(&batch);
+    unlock_config_folder();
+    return result == 0 ? 0 : 1;
 }
 
-int move_file_with_fallback(const char *src, const char *dest) {
-    if (check_path_length(src) || check_path_length(dest)) {
-        char *fallback_dest = create_fallback_path(dest);
-        if (!fallback_dest) {
-            return -1;
-        }
+int move_file_at(int src_dir_fd, const char *src_name, int dest_dir_fd, const char *dest_name) {
+    // Names are resolved relative to already-open directories, so the
+    // kernel never re-walks the full path and PATH_MAX never comes into it
+    if (renameat(src_dir_fd, src_name, dest_dir_fd, dest_name) == 0) {
+        return 0;
+    }
 
-        fprintf(stderr, "Using fallback path: %s\n", fallback_dest);
-        int result = rename(src, fallback_dest);
-        free(fallback_dest);
-        return result;
+    if (errno != EXDEV) {
+        return -1;
     }
 
-    return rename(src, dest);
+    // The category lives on another mount
+    return move_across_devices(src_dir_fd, src_name, dest_dir_fd, dest_name);
 }
 
 void ensure_config_folder(const char *config_folder) {
@@ -520,6 +1168,14 @@ void ensure_config_folder(const char *config_folder) {
 }
 
 void add_extension(const char *config_folder, const char *extension, const char *new_category) {
+    // Held from the read to the last write, so concurrent runs can't
+    // interleave their read-modify-write cycles
+    lock_config_folder(config_folder);
+    update_extension(config_folder, extension, new_category);
+    unlock_config_folder();
+}
+
+void update_extension(const char *config_folder, const char *extension, const char *new_category) {
     load_configs(config_folder);
 
     char *current_category = get_category_for_extension(extension);
@@ -543,16 +1199,13 @@ void add_extension(const char *config_folder, const char *extension, const char
         remove_extension_from_category(config_folder, extension, current_category);
     }
 
-    char *config_path = construct_config_path(config_folder, new_category);
-    cJSON *json = load_or_create_json(config_path);
-
-    add_extension_to_json(json, extension, new_category);
-    save_json_to_file(json, config_path, extension, new_category);
-
-    cJSON_Delete(json);
-    free(config_path);
+    // Only the touched category files changed, so patch the loaded rules
+    // and refresh the cache from memory instead of re-parsing every config
+    insert_extension(config_folder, extension, new_category);
 
-    reload_mappings(config_folder);
+    if (write_rule_cache(config_folder) != 0 && verbose) {
+        printf("Could not write rule cache to %s\n", config_folder);
+    }
 }
 
 char* get_default_config_path() {
@@ -572,10 +1225,20 @@ void load_configs(const char *config_folder) {
     free_existing_mappings();
     initialize_mappings();
 
+    // Unchanged configs are served straight from the compiled cache
+    if (load_rule_cache(config_folder) == 0) {
+        return;
+    }
+
+    // Hold the config lock from parse through the cache write so the mtimes
+    // recorded in rules.bin describe exactly the files that were parsed
+    lock_config_folder(config_folder);
+
     DIR *dir = opendir(config_folder);
     if (dir == NULL) {
         fprintf(stderr, "Unable to open config folder: %s\n", config_folder);
         handle_missing_configs(config_folder);
+        unlock_config_folder();
         return;
     }
 
@@ -590,35 +1253,21 @@ void load_configs(const char *config_folder) {
     }
 
     closedir(dir);
-}
+    refresh_filename_rules();
 
-int check_path_length(const char *path) {
-    if (strlen(path) >= PATH_MAX) {
-        fprintf(stderr, "Warning: Path exceeds maximum length (%d): %s\n", PATH_MAX, path);
-        return 1;
+    if (write_rule_cache(config_folder) != 0 && verbose) {
+        printf("Could not write rule cache to %s\n", config_folder);
     }
-    return 0;
-}
-
-char* create_fallback_path(const char *original_path) {
-    char *fallback = malloc(PATH_MAX);
-    if (!fallback) {
-        fprintf(stderr, "Memory allocation failed\n");
-        return NULL;
-    }
-    
-    const char *filename = strrchr(original_path, '/');
-    filename = filename ? filename + 1 : original_path;
-
-    snprintf(fallback, PATH_MAX, "%s%s", FALLBACK_PREFIX, filename);
-    return fallback;
+    unlock_config_folder();
 }
 
 void delete_config_files(const char *config_folder) {
+    lock_config_folder(config_folder);
     if (nftw(config_folder, delete_callback, 64, FTW_DEPTH | FTW_PHYS) == -1) {
         fprintf(stderr, "Error deleting config files: %s\n", strerror(errno));
         exit(EXIT_FAILURE);
     }
+    unlock_config_folder();
 }
 
 void organize_files(const char *directory) {
@@ -628,9 +1277,77 @@ void organize_files(const char *directory) {
     
     load_configs(config_folder);
 
-    bool handle_misc = check_for_uncategorized_files(directory);
-    
-    process_directory(directory, handle_misc);
+    if (recursive) {
+        organize_directory_tree(directory);
+        return;
+    }
+
+    int dir_fd = open(directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd == -1) {
+        fprintf(stderr, "Unable to open directory: %s\n", directory);
+        return;
+    }
+
+    ScanState state;
+    // A dry run moves nothing, so it has nothing to remember
+    bool remember = use_scan_state && move_plan == NULL && scan_state_open(&state, config_folder, dir_fd) == 0;
+    if (remember && scan_state_unchanged(&state)) {
+        if (verbose) printf("Nothing has changed in %s since the last run\n", directory);
+        scan_state_close(&state);
+        close(dir_fd);
+        return;
+    }
+
+    // One pass over the directory serves both the misc prompt and the moves
+    FileBatch batch;
+    if (!scan_directory_incremental(dir_fd, directory, &batch, remember ? &state : NULL)) {
+        if (remember) scan_state_close(&state);
+        close(dir_fd);
+        return;
+    }
+
+    // Planning never stops to ask; a "*" rule plans misc moves instead
+    bool handle_misc = batch.has_uncategorized && move_plan == NULL && prompt_for_misc_category();
+
+    MoveStats stats = process_file_batch(dir_fd, directory, &batch, handle_misc);
+
+    if (remember) {
+        bool moved_files = false;
+        for (size_t i = 0; i < batch.count; i++) {
+            if (batch.entries[i].category == NULL && !handle_misc) {
+                scan_state_keep(&state, dir_fd, batch.names + batch.entries[i].name_offset);
+            } else {
+                moved_files = true;
+            }
+        }
+        if (scan_state_save(&state, dir_fd, moved_files) != 0 && verbose) {
+            printf("Could not save scan state for %s\n", directory);
+        }
+        scan_state_close(&state);
+    }
+
+    free_file_batch(&batch);
+    close(dir_fd);
+
+    if ((verbose || jobs > 1) && move_plan == NULL) {
+        print_move_summary(&stats);
+    }
+}
+
+void organize_directory_tree(const char *directory) {
+    // An explicit --jobs 1 walks on this thread alone
+    int worker_count = jobs;
+    if (worker_count == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        worker_count = cpus > 0 ? (int)cpus : 1;
+    }
+
+    // Planning never stops to ask; a "*" rule plans misc moves instead
+    MoveStats stats = organize_tree(directory, move_plan == NULL, max_depth, worker_count);
+
+    if ((verbose || worker_count > 1) && move_plan == NULL) {
+        print_move_summary(&stats);
+    }
 }
 
 int delete_callback(const char *fpath, const struct stat *sb, int typeflag, struct FTW *ftwbuf) {
@@ -646,13 +1363,7 @@ int delete_callback(const char *fpath, const struct stat *sb, int typeflag, stru
 
 void reload_mappings(const char *config_folder) {
     // Free existing mappings
-    for (int i = 0; i < mapping_count; i++) {
-        free(mappings[i].extension);
-        free(mappings[i].category);
-    }
-    free(mappings);
-    mappings = NULL;
-    mapping_count = 0;
+    free_existing_mappings();
 
     // Reload mappings
     load_configs(config_folder);
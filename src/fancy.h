@@ -15,6 +15,9 @@
 #include <dirent.h>
 #include <libgen.h>
 #include <sys/stat.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/file.h>
 #include <unistd.h>
 #include <getopt.h>
 #include <ctype.h>
@@ -24,6 +27,7 @@
 #include <ftw.h>
 #include <strings.h>
 #include <limits.h>
+#include <stdint.h>
 #include <stdbool.h>
 
 #ifndef PROJECT_ROOT
@@ -32,8 +36,12 @@
 
 #define PATH_TO_ROOT PROJECT_ROOT
 
-#define MAX_EXTENSIONS 1000
-#define FALLBACK_PREFIX "/tmp/fancyD_fallback_"
+#define INITIAL_MAPPING_CAPACITY 256
+#define INITIAL_INDEX_CAPACITY 512
+#define INITIAL_CATEGORY_CAPACITY 32
+#define ARENA_BLOCK_SIZE (64 * 1024)
+#define CONFIG_WRITE_BUFFER_SIZE (64 * 1024)
+#define INITIAL_BATCH_CAPACITY 1024
 
 #ifndef FTW_DEPTH
 #define FTW_DEPTH 1
@@ -54,22 +62,53 @@ typedef struct {
     char *category;
 } ExtensionMapping;
 
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t size;
+    size_t used;
+    char data[];
+} ArenaBlock;
+
+typedef struct {
+    size_t name_offset;
+    const char *category;
+} FileEntry;
+
+typedef struct {
+    FileEntry *entries;
+    size_t count;
+    size_t capacity;
+    char *names;
+    size_t names_used;
+    size_t names_size;
+    bool has_uncategorized;
+} FileBatch;
+
+typedef struct {
+    size_t moved;
+    size_t skipped;
+    size_t failed;
+} MoveStats;
+
+struct ConfigBatch;
+struct ScanState;
+
 // Function prototypes
 void print_usage(const char *program_name);
 void ensure_config_folder(const char *config_folder);
 int create_default_configs(const char *config_folder);
 void load_configs(const char *config_folder);
 void organize_files(const char *directory);
+void organize_directory_tree(const char *directory);
 void add_extension(const char *config_folder, const char *extension, const char *new_category);
+void update_extension(const char *config_folder, const char *extension, const char *new_category);
 void print_string_details(const char* str);
 void reload_mappings(const char *config_folder);
 void reset_mappings(const char *config_folder);
 void delete_config_files(const char *config_folder);
 
 int delete_callback(const char *fpath, const struct stat *sb, int typeflag, struct FTW *ftwbuf);
-int check_path_length(const char *path);
-char* create_fallback_path(const char *original_path);
-int move_file_with_fallback(const char *src, const char *dest);
+int move_file_at(int src_dir_fd, const char *src_name, int dest_dir_fd, const char *dest_name);
 void remove_extension_from_config(const char *config_path, const char *extension);
 void list_extensions(const char *config_folder);
 int check_duplicate_extension(const char *config_folder, const char *extension, const char *new_category);
@@ -78,26 +117,54 @@ char* find_project_root();
 char* get_default_config_path();
 bool is_config_file(const char *filename);
 char* read_file_content(const char *filepath);
+int parse_json_file(const char *filepath, cJSON **json);
 void print_category_extensions(const char *filename, cJSON *json);
 char* construct_file_path(const char *folder, const char *filename);
-void process_default_config(const char *config_folder, const char *file_path);
+void process_default_config(struct ConfigBatch *batch, const char *file_path);
 void free_existing_mappings();
 void initialize_mappings();
+void grow_mappings(int capacity);
+char* arena_strdup(const char *str);
+char* intern_category(const char *category);
+char* insert_category(const char *category, bool borrow);
+bool is_plain_name(const char *name);
+bool is_category_name(const char *name);
 
 void handle_missing_configs(const char *config_folder);
 void process_config_file(const char *file_path);
 void handle_json_parse_error(const char *file_path);
 void add_mappings_from_json(cJSON *json);
 void add_mapping(const char *extension, const char *category);
+bool remove_mapping(const char *extension);
+unsigned long hash_extension(const char *extension);
+int find_mapping_index(const char *extension);
+void index_mapping(int mapping_idx);
+size_t find_index_slot(int mapping_idx);
+void unindex_slot(size_t slot);
+void resize_extension_index(size_t capacity);
+void rebuild_filename_rules();
+void refresh_filename_rules();
 bool check_for_uncategorized_files(const char *directory);
 bool is_special_directory(const char *name);
-bool is_regular_file(const char *path);
+bool is_regular_file(int dir_fd, const char *name);
+bool is_regular_entry(int dir_fd, const char *name, unsigned char d_type);
+bool scan_directory(const char *directory, FileBatch *batch);
+bool scan_directory_at(int dir_fd, const char *directory, FileBatch *batch);
+bool scan_directory_incremental(int dir_fd, const char *directory, FileBatch *batch, struct ScanState *state);
+void add_file_to_batch(FileBatch *batch, const char *name, const char *category);
+void free_file_batch(FileBatch *batch);
+MoveStats process_file_batch(int dir_fd, const char *directory, const FileBatch *batch, bool handle_misc);
+MoveStats move_batch_serially(int dir_fd, const char *directory, const FileBatch *batch, bool handle_misc);
+void print_move_summary(const MoveStats *stats);
 
 char* get_file_extension(const char *filename);
 char* get_category_for_extension(const char *extension);
+const char* match_filename_rules(const char *filename);
+const char* get_category_for_filename(const char *filename);
+const char* classify_file(int dir_fd, const char *name);
 bool prompt_for_misc_category();
 void process_directory(const char *directory, bool handle_misc);
-void process_file(const char *file_path, const char *directory, bool handle_misc);
+void process_file(int dir_fd, const char *directory, const char *name, bool handle_misc);
 bool prompt_for_extension_move(const char *extension, const char *old_category, const char *new_category);
 void remove_extension_from_category(const char *config_folder, const char *extension, const char *category);
 char* construct_config_path(const char *config_folder, const char *category);
@@ -105,10 +172,26 @@ char* construct_config_path(const char *config_folder, const char *category);
 cJSON* load_or_create_json(const char *config_path);
 void add_extension_to_json(cJSON *json, const char *extension, const char *category);
 void save_json_to_file(cJSON *json, const char *config_path, const char *extension, const char *category);
-void move_file_to_category(const char *file_path, const char *directory, const char *category);
+int write_config_file(const char *config_path, cJSON *json);
+void sync_parent_directory(const char *path);
+void lock_config_folder(const char *config_folder);
+void unlock_config_folder();
+void insert_extension(const char *config_folder, const char *extension, const char *category);
+int move_file_to_category(int dir_fd, const char *directory, const char *name, const char *category);
 
 extern ExtensionMapping *mappings;
 extern int mapping_count;
+extern int mapping_capacity;
+extern ArenaBlock *string_arena;
+extern int *extension_index;
+extern size_t index_capacity;
 extern int verbose;
+extern int jobs;
+extern bool use_io_uring;
+extern bool recursive;
+extern int max_depth;
+extern bool compact_configs;
+extern bool sniff_content;
+extern bool use_scan_state;
 
 #endif 
@@ -0,0 +1,371 @@
+/* =============================================================================
+   Program Name: FancyD (Fancy Directory Organizer)
+   Author: Nicholas D. Redmond (3A3YN1CKY)
+   Date: 8/13/2024
+   Description: Simple program to organize files in a directory.
+   ============================================================================= */
+
+#include <glob_rules.h>
+
+// The patterns are first laid out as one NFA: each pattern of k tokens owns
+// states base..base+k, where state base+i means "the first i tokens
+// matched" and base+k accepts. A '*' token loops on itself and also lets
+// the match skip ahead to the next token.
+enum { TOKEN_LITERAL, TOKEN_ANY, TOKEN_STAR, TOKEN_END };
+
+typedef struct {
+    unsigned char type;
+    unsigned char literal;
+    int rule;               // owning rule, for TOKEN_END states
+} NfaState;
+
+typedef struct {
+    NfaState *states;
+    int count;
+    int *starts;
+    int start_count;
+} Nfa;
+
+typedef struct {
+    int *members;           // sorted NFA state ids
+    int size;
+} StateSet;
+
+bool is_glob_pattern(const char *key) {
+    return strpbrk(key, "*?") != NULL;
+}
+
+void glob_matcher_init(GlobMatcher *matcher) {
+    memset(matcher, 0, sizeof(*matcher));
+}
+
+void glob_matcher_add(GlobMatcher *matcher, const char *pattern, const char *category) {
+    if (strcmp(pattern, "*") == 0) {
+        matcher->catch_all = category;
+        return;
+    }
+
+    if (matcher->rule_count == matcher->rule_capacity) {
+        size_t capacity = matcher->rule_capacity ? matcher->rule_capacity * 2 : 16;
+        GlobRule *rules = realloc(matcher->rules, sizeof(GlobRule) * capacity);
+        if (rules == NULL) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        matcher->rules = rules;
+        matcher->rule_capacity = capacity;
+    }
+
+    int literals = 0;
+    for (const char *p = pattern; *p; p++) {
+        if (*p != '*' && *p != '?') literals++;
+    }
+
+    GlobRule *rule = &matcher->rules[matcher->rule_count++];
+    rule->pattern = pattern;
+    rule->category = category;
+    rule->literal_count = literals;
+}
+
+static bool better_rule(const GlobMatcher *matcher, int candidate, int current) {
+    if (current < 0) return true;
+    const GlobRule *a = &matcher->rules[candidate];
+    const GlobRule *b = &matcher->rules[current];
+    if (a->literal_count != b->literal_count) return a->literal_count > b->literal_count;
+    return strcasecmp(a->pattern, b->pattern) < 0;
+}
+
+static void *checked_realloc(void *ptr, size_t size) {
+    void *grown = realloc(ptr, size);
+    if (grown == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    return grown;
+}
+
+static void build_nfa(const GlobMatcher *matcher, Nfa *nfa) {
+    size_t total = 0;
+    for (size_t r = 0; r < matcher->rule_count; r++) {
+        total += strlen(matcher->rules[r].pattern) + 1;
+    }
+
+    nfa->states = checked_realloc(NULL, sizeof(NfaState) * (total ? total : 1));
+    nfa->starts = checked_realloc(NULL, sizeof(int) * (matcher->rule_count ? matcher->rule_count : 1));
+    nfa->count = 0;
+    nfa->start_count = 0;
+
+    for (size_t r = 0; r < matcher->rule_count; r++) {
+        nfa->starts[nfa->start_count++] = nfa->count;
+        const char *p = matcher->rules[r].pattern;
+        for (; *p; p++) {
+            NfaState *state = &nfa->states[nfa->count];
+            state->rule = (int)r;
+            if (*p == '*') {
+                // "**" means the same as "*"
+                if (p > matcher->rules[r].pattern && p[-1] == '*') continue;
+                state->type = TOKEN_STAR;
+            } else if (*p == '?') {
+                state->type = TOKEN_ANY;
+            } else {
+                state->type = TOKEN_LITERAL;
+                state->literal = tolower((unsigned char)*p);
+            }
+            nfa->count++;
+        }
+        nfa->states[nfa->count].type = TOKEN_END;
+        nfa->states[nfa->count].rule = (int)r;
+        nfa->count++;
+    }
+}
+
+static int compare_ints(const void *a, const void *b) {
+    int x = *(const int *)a;
+    int y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+// Adds the epsilon closure (skipping over stars) and normalizes the set
+static void close_set(const Nfa *nfa, int *members, int *size, bool *seen) {
+    int count = *size;
+    for (int i = 0; i < count; i++) seen[members[i]] = true;
+    for (int i = 0; i < count; i++) {
+        int s = members[i];
+        while (nfa->states[s].type == TOKEN_STAR && !seen[s + 1]) {
+            seen[s + 1] = true;
+            members[count++] = s + 1;
+            s++;
+        }
+    }
+    for (int i = 0; i < count; i++) seen[members[i]] = false;
+    qsort(members, count, sizeof(int), compare_ints);
+    *size = count;
+}
+
+static unsigned long hash_set(const int *members, int size) {
+    unsigned long hash = 2166136261UL;
+    for (int i = 0; i < size; i++) {
+        hash ^= (unsigned long)members[i];
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+typedef struct {
+    GlobMatcher *matcher;
+    const Nfa *nfa;
+    StateSet *sets;
+    size_t set_capacity;
+    int *table;             // open-addressing map from state set to DFA state
+    size_t table_capacity;
+} DfaBuilder;
+
+static void index_set(DfaBuilder *builder, int dfa_state) {
+    size_t mask = builder->table_capacity - 1;
+    const StateSet *set = &builder->sets[dfa_state];
+    size_t slot = hash_set(set->members, set->size) & mask;
+    while (builder->table[slot] >= 0) slot = (slot + 1) & mask;
+    builder->table[slot] = dfa_state;
+}
+
+// Returns the DFA state for a closed set, creating it if needed, or -1
+// once the state limit is reached
+static int intern_set(DfaBuilder *builder, const int *members, int size) {
+    GlobMatcher *matcher = builder->matcher;
+    size_t mask = builder->table_capacity - 1;
+    for (size_t slot = hash_set(members, size) & mask; builder->table[slot] >= 0; slot = (slot + 1) & mask) {
+        const StateSet *set = &builder->sets[builder->table[slot]];
+        if (set->size == size && memcmp(set->members, members, sizeof(int) * size) == 0) {
+            return builder->table[slot];
+        }
+    }
+
+    if (matcher->dfa_states == MAX_GLOB_DFA_STATES) return -1;
+
+    if ((size_t)matcher->dfa_states == builder->set_capacity) {
+        builder->set_capacity = builder->set_capacity ? builder->set_capacity * 2 : 64;
+        builder->sets = checked_realloc(builder->sets, sizeof(StateSet) * builder->set_capacity);
+        matcher->transitions = checked_realloc(matcher->transitions,
+                                               sizeof(int) * builder->set_capacity * matcher->class_count);
+        matcher->accept = checked_realloc(matcher->accept, sizeof(int) * builder->set_capacity);
+    }
+
+    int dfa_state = matcher->dfa_states++;
+    StateSet *set = &builder->sets[dfa_state];
+    set->members = checked_realloc(NULL, sizeof(int) * size);
+    memcpy(set->members, members, sizeof(int) * size);
+    set->size = size;
+
+    matcher->accept[dfa_state] = -1;
+    for (int i = 0; i < size; i++) {
+        const NfaState *state = &builder->nfa->states[members[i]];
+        if (state->type == TOKEN_END && better_rule(matcher, state->rule, matcher->accept[dfa_state])) {
+            matcher->accept[dfa_state] = state->rule;
+        }
+    }
+
+    if ((size_t)matcher->dfa_states * 2 > builder->table_capacity) {
+        builder->table_capacity *= 2;
+        builder->table = checked_realloc(builder->table, sizeof(int) * builder->table_capacity);
+        memset(builder->table, 0xff, sizeof(int) * builder->table_capacity);
+        for (int d = 0; d < matcher->dfa_states; d++) index_set(builder, d);
+    } else {
+        index_set(builder, dfa_state);
+    }
+    return dfa_state;
+}
+
+void glob_matcher_compile(GlobMatcher *matcher) {
+    free(matcher->transitions);
+    free(matcher->accept);
+    matcher->transitions = NULL;
+    matcher->accept = NULL;
+    matcher->dfa_states = 0;
+
+    if (matcher->rule_count == 0) return;
+
+    Nfa nfa;
+    build_nfa(matcher, &nfa);
+
+    // Bytes that no pattern names literally all behave the same, so they
+    // share class 0; each literal (case-folded) gets a class of its own
+    unsigned char literal_class[256] = {0};
+    int class_count = 1;
+    for (int s = 0; s < nfa.count; s++) {
+        if (nfa.states[s].type == TOKEN_LITERAL && literal_class[nfa.states[s].literal] == 0) {
+            literal_class[nfa.states[s].literal] = (unsigned char)class_count++;
+        }
+    }
+    for (int b = 0; b < 256; b++) {
+        matcher->byte_class[b] = literal_class[tolower(b)];
+    }
+    matcher->class_count = class_count;
+
+    DfaBuilder builder = {0};
+    builder.matcher = matcher;
+    builder.nfa = &nfa;
+    builder.table_capacity = 256;
+    builder.table = checked_realloc(NULL, sizeof(int) * builder.table_capacity);
+    memset(builder.table, 0xff, sizeof(int) * builder.table_capacity);
+
+    bool *seen = calloc(nfa.count, sizeof(bool));
+    int *scratch = checked_realloc(NULL, sizeof(int) * nfa.count);
+    if (seen == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+
+    // State 0 has every pattern at its first token
+    memcpy(scratch, nfa.starts, sizeof(int) * nfa.start_count);
+    int scratch_size = nfa.start_count;
+    close_set(&nfa, scratch, &scratch_size, seen);
+    intern_set(&builder, scratch, scratch_size);
+
+    // Fill the transition table row by row; new states append rows as
+    // they are discovered, so this ends when every row is done
+    bool overflow = false;
+    for (int work = 0; work < matcher->dfa_states * class_count; work++) {
+        const StateSet *set = &builder.sets[work / class_count];
+        int byte_class = work % class_count;
+
+        scratch_size = 0;
+        for (int i = 0; i < set->size; i++) {
+            int s = set->members[i];
+            const NfaState *state = &nfa.states[s];
+            int next = -1;
+            if (state->type == TOKEN_STAR) {
+                next = s;
+            } else if (state->type == TOKEN_ANY) {
+                next = s + 1;
+            } else if (state->type == TOKEN_LITERAL && literal_class[state->literal] == byte_class) {
+                next = s + 1;
+            }
+            if (next >= 0 && !seen[next]) {
+                seen[next] = true;
+                scratch[scratch_size++] = next;
+            }
+        }
+        for (int i = 0; i < scratch_size; i++) seen[scratch[i]] = false;
+
+        int target = -1;
+        if (scratch_size > 0) {
+            close_set(&nfa, scratch, &scratch_size, seen);
+            target = intern_set(&builder, scratch, scratch_size);
+            if (target < 0) {
+                overflow = true;
+                break;
+            }
+        }
+        matcher->transitions[work] = target;
+    }
+
+    for (int d = 0; d < matcher->dfa_states; d++) free(builder.sets[d].members);
+    free(builder.sets);
+    free(builder.table);
+    free(seen);
+    free(scratch);
+    free(nfa.states);
+    free(nfa.starts);
+
+    if (overflow) {
+        // Pathological pattern sets fall back to matching each rule in turn
+        fprintf(stderr, "Too many wildcard rules to compile; matching them one by one\n");
+        free(matcher->transitions);
+        free(matcher->accept);
+        matcher->transitions = NULL;
+        matcher->accept = NULL;
+        matcher->dfa_states = 0;
+    }
+}
+
+static bool glob_match_one(const char *pattern, const char *name) {
+    // Iterative matcher with single-star backtracking, used only when the
+    // DFA would have been too large
+    const char *star = NULL;
+    const char *resume = NULL;
+    while (*name) {
+        if (*pattern == '*') {
+            star = pattern++;
+            resume = name;
+        } else if (*pattern == '?' || (*pattern && tolower((unsigned char)*pattern) == tolower((unsigned char)*name))) {
+            pattern++;
+            name++;
+        } else if (star != NULL) {
+            pattern = star + 1;
+            name = ++resume;
+        } else {
+            return false;
+        }
+    }
+    while (*pattern == '*') pattern++;
+    return *pattern == '\0';
+}
+
+const char *glob_matcher_match(const GlobMatcher *matcher, const char *filename) {
+    if (matcher->rule_count == 0) return NULL;
+
+    if (matcher->dfa_states == 0) {
+        int best = -1;
+        for (size_t r = 0; r < matcher->rule_count; r++) {
+            if (glob_match_one(matcher->rules[r].pattern, filename) && better_rule(matcher, (int)r, best)) {
+                best = (int)r;
+            }
+        }
+        return best >= 0 ? matcher->rules[best].category : NULL;
+    }
+
+    int state = 0;
+    for (const unsigned char *p = (const unsigned char *)filename; *p; p++) {
+        state = matcher->transitions[state * matcher->class_count + matcher->byte_class[*p]];
+        if (state < 0) return NULL;
+    }
+    int rule = matcher->accept[state];
+    return rule >= 0 ? matcher->rules[rule].category : NULL;
+}
+
+void glob_matcher_destroy(GlobMatcher *matcher) {
+    free(matcher->rules);
+    free(matcher->transitions);
+    free(matcher->accept);
+    glob_matcher_init(matcher);
+}
@@ -0,0 +1,48 @@
+/* =============================================================================
+   Program Name: FancyD (Fancy Directory Organizer)
+   Author: Nicholas D. Redmond (3A3YN1CKY)
+   Date: 8/13/2024
+   Description: Simple program to organize files in a directory.
+   ============================================================================= */
+
+#ifndef GLOB_RULES_H
+#define GLOB_RULES_H
+
+#include <fancy.h>
+
+#define MAX_GLOB_DFA_STATES 4096
+
+typedef struct {
+    const char *pattern;
+    const char *category;
+    int literal_count;
+} GlobRule;
+
+// Config keys containing '*' or '?' are matched against the whole filename,
+// case-insensitively. A bare "*" is the catch-all and is kept aside; every
+// other pattern is compiled into one DFA over byte classes, so a filename
+// is matched in a single pass however many patterns there are. When several
+// patterns match, the one with the most literal characters wins.
+typedef struct {
+    GlobRule *rules;
+    size_t rule_count;
+    size_t rule_capacity;
+    const char *catch_all;
+
+    unsigned char byte_class[256];
+    int class_count;
+    int *transitions;       // dfa_states * class_count, -1 means no match possible
+    int *accept;            // per DFA state: index into rules[] or -1
+    int dfa_states;
+} GlobMatcher;
+
+bool is_glob_pattern(const char *key);
+void glob_matcher_init(GlobMatcher *matcher);
+void glob_matcher_add(GlobMatcher *matcher, const char *pattern, const char *category);
+void glob_matcher_compile(GlobMatcher *matcher);
+const char *glob_matcher_match(const GlobMatcher *matcher, const char *filename);
+void glob_matcher_destroy(GlobMatcher *matcher);
+
+extern GlobMatcher glob_rules;
+
+#endif // GLOB_RULES_H
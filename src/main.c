@@ -8,6 +8,14 @@
 #include <fancy.h>
 #include <color_utils.h>
 #include <utils.h>
+#include <dir_reader.h>
+#include <move_pool.h>
+#include <uring_backend.h>
+#include <config_batch.h>
+#include <watch.h>
+#include <move_plan.h>
+#include <move_journal.h>
+#include <collision.h>
 
 void segfault_handler(int signal) {
     (void)signal; // Suppress if not used
@@ -15,12 +23,35 @@ void segfault_handler(int signal) {
     exit(1);
 }
 
+// Starts recording moves when --journal was given. Only called right
+// before files move, so no early exit can leave the journal unflushed.
+static int open_journal(MoveJournal *journal, const char *journal_path) {
+    if (journal_path == NULL) return 0;
+    if (move_journal_open(journal, journal_path) != 0) return -1;
+    move_journal = journal;
+    return 0;
+}
+
+// Flushes the journal, if one is being written; returns -1 if any of it was lost
+static int close_journal(MoveJournal *journal) {
+    if (move_journal == NULL) return 0;
+    move_journal = NULL;
+    return move_journal_close(journal);
+}
+
 int main(int argc, char *argv[]) {
     signal(SIGSEGV, segfault_handler);
   
     char *directory = ".";
     char *extension = NULL;
     char *category = NULL;
+    char *import_path = NULL;
+    char *watch_path = NULL;
+    char *plan_path = NULL;
+    char *apply_path = NULL;
+    char *journal_path = NULL;
+    char *undo_path = NULL;
+    ConflictPolicy conflict_policy = CONFLICT_KEEP;
 
     char config_folder[MAX_PATH];
     const char *home = getenv("HOME");
@@ -38,13 +69,30 @@ int main(int argc, char *argv[]) {
         {"default", no_argument, 0, 'd'},
         {"reset", no_argument, 0, 'r'},
         {"verbose", no_argument, 0, 'v'},
+        {"jobs", required_argument, 0, 'j'},
+        {"io-uring", no_argument, 0, 'u'},
+        {"recursive", no_argument, 0, 'R'},
+        {"max-depth", required_argument, 0, 'D'},
+        {"dir-buffer", required_argument, 0, 'B'},
+        {"import", required_argument, 0, 'i'},
+        {"on-conflict", required_argument, 0, 'C'},
+        {"compact", no_argument, 0, 'c'},
+        {"sniff", no_argument, 0, 's'},
+        {"watch", required_argument, 0, 'w'},
+        {"state", no_argument, 0, 'S'},
+        {"dry-run", no_argument, 0, 'n'},
+        {"plan", required_argument, 0, 'P'},
+        {"apply", required_argument, 0, 'A'},
+        {"journal", required_argument, 0, 'J'},
+        {"undo", required_argument, 0, 'U'},
+        {"on-collision", required_argument, 0, 'x'},
         {0, 0, 0, 0}
     };
 
     int opt;
     int option_index = 0;
 
-    while ((opt = getopt_long(argc, argv, "a:hdrlv", long_options, &option_index)) != -1) {
+    while ((opt = getopt_long(argc, argv, "a:hdrlvj:uRD:B:i:C:csw:SnP:A:J:U:x:", long_options, &option_index)) != -1) {
         switch (opt) {
             case 'a':
                 if (optind < argc) {
@@ -78,6 +126,89 @@ int main(int argc, char *argv[]) {
             case 'v':
                 verbose = 1;
                 break;
+            case 'j': {
+                char *end;
+                long n = strtol(optarg, &end, 10);
+                if (*end != '\0' || n < 1 || n > MAX_JOBS) {
+                    print_red("Error: --jobs takes a number between 1 and %d\n", MAX_JOBS);
+                    return 1;
+                }
+                jobs = (int)n;
+                break;
+            }
+            case 'u':
+                if (uring_available()) {
+                    use_io_uring = true;
+                } else {
+                    print_yellow("Built without io_uring support, using synchronous moves\n");
+                }
+                break;
+            case 'R':
+                recursive = true;
+                break;
+            case 'D': {
+                char *end;
+                long n = strtol(optarg, &end, 10);
+                if (*end != '\0' || n < 0 || n > INT_MAX) {
+                    print_red("Error: --max-depth takes a non-negative number\n");
+                    return 1;
+                }
+                max_depth = (int)n;
+                break;
+            }
+            case 'B': {
+                char *end;
+                unsigned long kib = strtoul(optarg, &end, 10);
+                if (*end != '\0' || kib * 1024 < MIN_DIR_BUFFER_SIZE || kib * 1024 > MAX_DIR_BUFFER_SIZE) {
+                    print_red("Error: --dir-buffer takes a size in KiB between %d and %d\n",
+                              MIN_DIR_BUFFER_SIZE / 1024, MAX_DIR_BUFFER_SIZE / 1024);
+                    return 1;
+                }
+                dir_buffer_size = kib * 1024;
+                break;
+            }
+            case 'i':
+                import_path = optarg;
+                break;
+            case 'C':
+                if (parse_conflict_policy(optarg, &conflict_policy) != 0) {
+                    print_red("Error: --on-conflict takes keep, replace or abort\n");
+                    return 1;
+                }
+                break;
+            case 'c':
+                compact_configs = true;
+                break;
+            case 's':
+                sniff_content = true;
+                break;
+            case 'w':
+                watch_path = optarg;
+                break;
+            case 'S':
+                use_scan_state = true;
+                break;
+            case 'n':
+                plan_path = "-";
+                break;
+            case 'P':
+                plan_path = optarg;
+                break;
+            case 'A':
+                apply_path = optarg;
+                break;
+            case 'J':
+                journal_path = optarg;
+                break;
+            case 'U':
+                undo_path = optarg;
+                break;
+            case 'x':
+                if (parse_collision_policy(optarg, &collision_policy) != 0) {
+                    print_red("Error: --on-collision takes suffix, skip or compare\n");
+                    return 1;
+                }
+                break;
             default:
                 print_yellow("Try '%s --help' for more information.\n", argv[0]);
                 return 1;
@@ -89,9 +220,33 @@ int main(int argc, char *argv[]) {
     }
 
     ensure_config_folder(config_folder);
-    
-    if (extension && category) {
+
+    if (undo_path) {
+        return undo_move_journal(undo_path) == 0 ? 0 : 1;
+    }
+
+    // Opened by whichever branch below actually moves files
+    MoveJournal journal;
+
+    if (import_path) {
+        int result = import_rules(config_folder, import_path, conflict_policy);
+        free_existing_mappings();
+        return result == 0 ? 0 : 1;
+    } else if (extension && category) {
         add_extension(config_folder, extension, category);
+    } else if (apply_path) {
+        if (open_journal(&journal, journal_path) != 0) return 1;
+        int result = apply_move_plan(apply_path);
+        if (close_journal(&journal) != 0) result = -1;
+        free_existing_mappings();
+        return result == 0 ? 0 : 1;
+    } else if (watch_path) {
+        // Runs unattended, so there's no misc prompt; a "*" rule covers that
+        if (open_journal(&journal, journal_path) != 0) return 1;
+        int result = watch_directory(watch_path, config_folder);
+        if (close_journal(&journal) != 0) result = -1;
+        free_existing_mappings();
+        return result == 0 ? 0 : 1;
     } else {
         // Check if any config files exist
         DIR *dir = opendir(config_folder);
@@ -99,7 +254,7 @@ int main(int argc, char *argv[]) {
         int config_count = 0;
         if (dir != NULL) {
             while ((ent = readdir(dir)) != NULL) {
-                if (strstr(ent->d_name, "_config.json") != NULL) {
+                if (is_config_file(ent->d_name)) {
                     config_count++;
                     break;
                 }
@@ -107,6 +262,11 @@ int main(int argc, char *argv[]) {
             closedir(dir);
         }
 
+        if (config_count == 0 && plan_path) {
+            print_yellow("No categories available. Use --default to set up categories.\n");
+            return 0;
+        }
+
         if (config_count == 0) {
             char response;
             print_yellow("There are no categories added. Do you want to put everything in 'misc'? (y/n): ");
@@ -122,11 +282,14 @@ int main(int argc, char *argv[]) {
                     return 1;
                 }
 
-                // Use misc_config_path...
-                FILE *misc_file = fopen(misc_config_path, "w");
-                if (misc_file) {
-                    fprintf(misc_file, "{\n  \"*\": \"misc\"\n}");
-                    fclose(misc_file);
+                cJSON *misc_json = cJSON_CreateObject();
+                cJSON_AddStringToObject(misc_json, "*", "misc");
+                lock_config_folder(config_folder);
+                int written = write_config_file(misc_config_path, misc_json);
+                unlock_config_folder();
+                cJSON_Delete(misc_json);
+
+                if (written == 0) {
                     free(misc_config_path);
                     print_green("Created 'misc' category for all files.\n");
                 } else {
@@ -140,15 +303,35 @@ int main(int argc, char *argv[]) {
             }
         }
 
+        // A dry run records a plan instead of moving, so it has no journal
+        MovePlan plan;
+        if (plan_path) {
+            if (move_plan_open(&plan, plan_path) != 0) {
+                return 1;
+            }
+            move_plan = &plan;
+        } else if (open_journal(&journal, journal_path) != 0) {
+            return 1;
+        }
+
         load_configs(config_folder);
         organize_files(directory);
+
+        if (close_journal(&journal) != 0) {
+            free_existing_mappings();
+            return 1;
+        }
+
+        if (move_plan) {
+            move_plan = NULL;
+            if (move_plan_close(&plan) != 0) {
+                free_existing_mappings();
+                return 1;
+            }
+        }
     }
 
     // Free all that precious memory
-    for (int i = 0; i < mapping_count; i++) {
-        free(mappings[i].extension);
-        free(mappings[i].category);
-    }
-    free(mappings);
+    free_existing_mappings();
     return 0;
 }
\ No newline at end of file
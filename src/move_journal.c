@@ -0,0 +1,534 @@
+/* =============================================================================
+   Program Name: FancyD (Fancy Directory Organizer)
+   Author: Nicholas D. Redmond (3A3YN1CKY)
+   Date: 8/13/2024
+   Description: Simple program to organize files in a directory.
+   ============================================================================= */
+
+#include <move_journal.h>
+#include <xdev_move.h>
+#include <uring_backend.h>
+#include <sys/mman.h>
+
+MoveJournal *move_journal = NULL;
+
+static uint64_t hash_directory(const char *directory) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (; *directory; directory++) {
+        hash ^= (unsigned char)*directory;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+int move_journal_open(MoveJournal *journal, const char *path) {
+    memset(journal, 0, sizeof(*journal));
+
+    journal->file = fopen(path, "ab");
+    if (journal->file == NULL) {
+        fprintf(stderr, "Unable to open journal %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    setvbuf(journal->file, NULL, _IOFBF, MOVE_JOURNAL_BUFFER_SIZE);
+
+    // A new journal gets a header; an existing one must already be a journal
+    struct stat st;
+    MoveJournalHeader header = {0};
+    bool ok = fstat(fileno(journal->file), &st) == 0;
+    if (ok && st.st_size == 0) {
+        memcpy(header.magic, MOVE_JOURNAL_MAGIC, sizeof(MOVE_JOURNAL_MAGIC));
+        header.version = MOVE_JOURNAL_VERSION;
+        ok = fwrite(&header, sizeof(header), 1, journal->file) == 1;
+    } else if (ok) {
+        ok = pread(fileno(journal->file), &header, sizeof(header), 0) == (ssize_t)sizeof(header) &&
+             memcmp(header.magic, MOVE_JOURNAL_MAGIC, sizeof(MOVE_JOURNAL_MAGIC)) == 0 &&
+             header.version == MOVE_JOURNAL_VERSION;
+    }
+    if (!ok) {
+        fprintf(stderr, "%s is not a FancyD journal\n", path);
+        fclose(journal->file);
+        journal->file = NULL;
+        return -1;
+    }
+
+    journal->directory_capacity = 64;
+    journal->directories = calloc(journal->directory_capacity, sizeof(JournalDirectory));
+    if (journal->directories == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    pthread_mutex_init(&journal->lock, NULL);
+    return 0;
+}
+
+static void write_record(MoveJournal *journal, const MoveJournalRecord *record,
+                         const char *first, const char *second, const char *third) {
+    bool ok = fwrite(record, sizeof(*record), 1, journal->file) == 1 &&
+              fwrite(first, 1, record->name_length, journal->file) == record->name_length;
+    if (record->type == JOURNAL_MOVE) {
+        ok = ok && fwrite(second, 1, record->category_length, journal->file) == record->category_length &&
+             fwrite(third, 1, record->dest_length, journal->file) == record->dest_length;
+    }
+    if (!ok) journal->failed = true;
+}
+
+static void grow_directories(MoveJournal *journal) {
+    size_t capacity = journal->directory_capacity * 2;
+    JournalDirectory *directories = calloc(capacity, sizeof(JournalDirectory));
+    if (directories == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+
+    for (size_t i = 0; i < journal->directory_capacity; i++) {
+        JournalDirectory *entry = &journal->directories[i];
+        if (entry->directory == NULL) continue;
+        size_t slot = hash_directory(entry->directory) & (capacity - 1);
+        while (directories[slot].directory != NULL) slot = (slot + 1) & (capacity - 1);
+        directories[slot] = *entry;
+    }
+
+    free(journal->directories);
+    journal->directories = directories;
+    journal->directory_capacity = capacity;
+}
+
+// Called with the lock held
+static uint32_t directory_id(MoveJournal *journal, const char *directory) {
+    size_t mask = journal->directory_capacity - 1;
+    size_t slot = hash_directory(directory) & mask;
+    while (journal->directories[slot].directory != NULL) {
+        if (strcmp(journal->directories[slot].directory, directory) == 0) {
+            return journal->directories[slot].id;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    // First move out of this directory: record where it really is, so the
+    // journal can be undone from any working directory
+    char resolved[MAX_PATH];
+    const char *path = realpath(directory, resolved) != NULL ? resolved : directory;
+
+    MoveJournalRecord record = {0};
+    record.type = JOURNAL_DIRECTORY;
+    record.directory_id = journal->directory_count;
+    record.name_length = strlen(path);
+    write_record(journal, &record, path, NULL, NULL);
+
+    JournalDirectory *entry = &journal->directories[slot];
+    entry->directory = strdup(directory);
+    if (entry->directory == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    entry->id = journal->directory_count++;
+
+    if ((size_t)journal->directory_count * 2 > journal->directory_capacity) {
+        grow_directories(journal);
+    }
+    return record.directory_id;
+}
+
+void journal_move(const char *directory, const char *name, const char *category, const char *dest_name) {
+    MoveJournal *journal = move_journal;
+    if (journal == NULL) return;
+
+    size_t category_length = strlen(category);
+    if (category_length > UINT16_MAX) {
+        journal->failed = true;
+        return;
+    }
+
+    pthread_mutex_lock(&journal->lock);
+    MoveJournalRecord record = {0};
+    record.type = JOURNAL_MOVE;
+    record.directory_id = directory_id(journal, directory);
+    record.name_length = strlen(name);
+    record.category_length = (uint16_t)category_length;
+    record.dest_length = strlen(dest_name);
+    write_record(journal, &record, name, category, dest_name);
+    pthread_mutex_unlock(&journal->lock);
+}
+
+void journal_category_created(const char *directory, const char *category) {
+    MoveJournal *journal = move_journal;
+    if (journal == NULL) return;
+
+    pthread_mutex_lock(&journal->lock);
+    MoveJournalRecord record = {0};
+    record.type = JOURNAL_CATEGORY;
+    record.directory_id = directory_id(journal, directory);
+    record.name_length = strlen(category);
+    write_record(journal, &record, category, NULL, NULL);
+    pthread_mutex_unlock(&journal->lock);
+}
+
+int move_journal_close(MoveJournal *journal) {
+    bool ok = fclose(journal->file) == 0 && !journal->failed;
+    journal->file = NULL;
+
+    for (size_t i = 0; i < journal->directory_capacity; i++) {
+        free(journal->directories[i].directory);
+    }
+    free(journal->directories);
+    journal->directories = NULL;
+    pthread_mutex_destroy(&journal->lock);
+
+    if (!ok) {
+        fprintf(stderr, "Failed to write move journal\n");
+        return -1;
+    }
+    return 0;
+}
+
+typedef struct {
+    const char *directory;
+    uint32_t directory_length;
+    const char *name;
+    uint32_t name_length;
+    const char *category;
+    uint32_t category_length;
+    const char *dest_name;
+    uint32_t dest_length;
+    size_t position;
+} JournalMove;
+
+static int compare_directories(const JournalMove *left, const JournalMove *right) {
+    if (left->directory_length != right->directory_length) {
+        return left->directory_length < right->directory_length ? -1 : 1;
+    }
+    return memcmp(left->directory, right->directory, left->directory_length);
+}
+
+static int compare_for_undo(const void *a, const void *b) {
+    // Same directory together, newest move first within it
+    const JournalMove *left = a;
+    const JournalMove *right = b;
+    int order = compare_directories(left, right);
+    if (order != 0) return order;
+    if (left->position == right->position) return 0;
+    return left->position > right->position ? -1 : 1;
+}
+
+static bool copy_string(char *buffer, size_t size, const char *str, uint32_t length) {
+    if (length == 0 || length >= size || memchr(str, '\0', length) != NULL) return false;
+    memcpy(buffer, str, length);
+    buffer[length] = '\0';
+    return true;
+}
+
+// Puts one file back, refusing to overwrite anything that has since
+// taken its old name
+static int restore_file(int category_fd, const char *dest_name, int dir_fd, const char *name) {
+#ifdef RENAME_NOREPLACE
+    if (renameat2(category_fd, dest_name, dir_fd, name, RENAME_NOREPLACE) == 0) return 0;
+    if (errno == EXDEV) return move_across_devices(category_fd, dest_name, dir_fd, name);
+    if (errno != EINVAL && errno != ENOSYS) return -1;
+#endif
+    struct stat st;
+    if (fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+        errno = EEXIST;
+        return -1;
+    }
+    return move_file_at(category_fd, dest_name, dir_fd, name);
+}
+
+typedef struct {
+    const char *directory;
+    uint32_t directory_length;
+    const char *category;
+    uint32_t category_length;
+} JournalCategory;
+
+typedef struct {
+    char name[MAX_PATH];
+    int fd;
+} UndoCategory;
+
+static bool created_by_journal(const JournalCategory *created, size_t created_count,
+                               const JournalMove *move, const char *category) {
+    size_t length = strlen(category);
+    for (size_t i = 0; i < created_count; i++) {
+        if (created[i].directory_length == move->directory_length &&
+            created[i].category_length == length &&
+            memcmp(created[i].directory, move->directory, move->directory_length) == 0 &&
+            memcmp(created[i].category, category, length) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void undo_directory(const JournalMove *moves, size_t count, const JournalCategory *created,
+                           size_t created_count, MoveStats *stats) {
+    char directory[MAX_PATH];
+    if (!copy_string(directory, sizeof(directory), moves[0].directory, moves[0].directory_length)) {
+        stats->failed += count;
+        return;
+    }
+
+    int dir_fd = open(directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd == -1) {
+        fprintf(stderr, "Unable to open directory: %s\n", directory);
+        stats->failed += count;
+        return;
+    }
+
+    UndoCategory *categories = NULL;
+    size_t category_count = 0;
+    char name[MAX_PATH];
+    char category[MAX_PATH];
+    char dest_name[MAX_PATH];
+
+    // Restores run from the category back to the directory; restore_category
+    // says which category each one comes from, for messages
+    UringRename *restores = malloc(sizeof(UringRename) * count);
+    size_t *restore_category = malloc(sizeof(size_t) * count);
+    if (restores == NULL || restore_category == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    size_t restore_count = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        const JournalMove *move = &moves[i];
+        if (!copy_string(name, sizeof(name), move->name, move->name_length) ||
+            !copy_string(category, sizeof(category), move->category, move->category_length) ||
+            !copy_string(dest_name, sizeof(dest_name), move->dest_name, move->dest_length) ||
+            !is_plain_name(name) || !is_plain_name(category) || !is_plain_name(dest_name)) {
+            stats->failed++;
+            continue;
+        }
+
+        size_t c;
+        for (c = 0; c < category_count && strcmp(categories[c].name, category) != 0; c++);
+        if (c == category_count) {
+            UndoCategory *grown = realloc(categories, sizeof(UndoCategory) * (category_count + 1));
+            if (grown == NULL) {
+                fprintf(stderr, "Memory allocation failed\n");
+                exit(1);
+            }
+            categories = grown;
+            strcpy(categories[c].name, category);
+            categories[c].fd = openat(dir_fd, category, O_PATH | O_DIRECTORY | O_CLOEXEC);
+            category_count++;
+        }
+
+        if (categories[c].fd == -1) {
+            fprintf(stderr, "Failed to restore %s/%s from %s/%s: %s\n",
+                    directory, name, category, dest_name, strerror(errno));
+            stats->failed++;
+            continue;
+        }
+
+        UringRename *restore = &restores[restore_count];
+        restore->src_dir_fd = categories[c].fd;
+        restore->src_name = strdup(dest_name);
+        restore->dest_dir_fd = dir_fd;
+        restore->dest_name = strdup(name);
+        if (restore->src_name == NULL || restore->dest_name == NULL) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        restore_category[restore_count++] = c;
+    }
+
+    // With --io-uring the restores go to the kernel a group at a time.
+    // Completions within a group come back in any order, so a name being
+    // restored twice (newest copy first) starts a new group.
+    bool batched = use_io_uring;
+    for (size_t start = 0; start < restore_count; ) {
+        size_t end = start + 1;
+        if (batched) {
+            for (; end < restore_count && end - start < URING_BATCH_SIZE; end++) {
+                size_t j;
+                for (j = start; j < end && strcmp(restores[j].dest_name, restores[end].dest_name) != 0; j++);
+                if (j < end) break;
+            }
+            if (uring_rename_batch(restores + start, end - start) != 0) batched = false;
+        }
+
+        for (size_t i = start; i < end; i++) {
+            UringRename *restore = &restores[i];
+            const char *category_name = categories[restore_category[i]].name;
+
+            // The kernel's verdict stands unless it couldn't do the rename
+            // at all (old kernel, another mount); those go the slow way
+            int result;
+            if (batched && (restore->result == 0 || restore->result == -EEXIST || restore->result == -ENOENT)) {
+                result = restore->result;
+            } else {
+                result = restore_file(restore->src_dir_fd, restore->src_name, dir_fd, restore->dest_name) == 0
+                             ? 0 : -errno;
+            }
+
+            if (result != 0) {
+                fprintf(stderr, "Failed to restore %s/%s from %s/%s: %s\n",
+                        directory, restore->dest_name, category_name, restore->src_name, strerror(-result));
+                stats->failed++;
+            } else {
+                if (verbose) {
+                    printf("Restored %s from %s\n", restore->dest_name, category_name);
+                }
+                stats->moved++;
+            }
+            free((char *)restore->src_name);
+            free((char *)restore->dest_name);
+        }
+        start = end;
+    }
+    free(restores);
+    free(restore_category);
+
+    // Category folders a run created are empty again now; ones that were
+    // already there stay, and so does anything still holding files
+    for (size_t c = 0; c < category_count; c++) {
+        if (categories[c].fd != -1) close(categories[c].fd);
+        if (created_by_journal(created, created_count, &moves[0], categories[c].name)) {
+            unlinkat(dir_fd, categories[c].name, AT_REMOVEDIR);
+        }
+    }
+    free(categories);
+    close(dir_fd);
+}
+
+int undo_move_journal(const char *path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        fprintf(stderr, "Unable to open journal %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(MoveJournalHeader)) {
+        fprintf(stderr, "%s is not a FancyD journal\n", path);
+        close(fd);
+        return -1;
+    }
+
+    void *base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "Unable to read journal %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    const char *data = base;
+    size_t length = st.st_size;
+    const MoveJournalHeader *header = base;
+    if (memcmp(header->magic, MOVE_JOURNAL_MAGIC, sizeof(MOVE_JOURNAL_MAGIC)) != 0 ||
+        header->version != MOVE_JOURNAL_VERSION) {
+        fprintf(stderr, "%s is not a FancyD journal\n", path);
+        munmap(base, length);
+        return -1;
+    }
+
+    // Directory ids start over in each run appended to the journal, so
+    // they are resolved to their paths as the records are read
+    const char **directories = NULL;
+    uint32_t *directory_lengths = NULL;
+    uint32_t directory_count = 0;
+    JournalMove *moves = NULL;
+    size_t move_count = 0;
+    size_t move_capacity = 0;
+    JournalCategory *created = NULL;
+    size_t created_count = 0;
+    bool torn = false;
+
+    size_t offset = sizeof(MoveJournalHeader);
+    while (offset < length) {
+        MoveJournalRecord record;
+        if (length - offset < sizeof(record)) {
+            torn = true;
+            break;
+        }
+        memcpy(&record, data + offset, sizeof(record));
+        offset += sizeof(record);
+
+        size_t body = (size_t)record.name_length;
+        if (record.type == JOURNAL_MOVE) body += (size_t)record.category_length + record.dest_length;
+        if (length - offset < body) {
+            torn = true;
+            break;
+        }
+
+        if (record.type == JOURNAL_DIRECTORY) {
+            if (record.directory_id > directory_count) {
+                torn = true;
+                break;
+            }
+            if (record.directory_id == directory_count) {
+                directories = realloc(directories, sizeof(char *) * (directory_count + 1));
+                directory_lengths = realloc(directory_lengths, sizeof(uint32_t) * (directory_count + 1));
+                if (directories == NULL || directory_lengths == NULL) {
+                    fprintf(stderr, "Memory allocation failed\n");
+                    exit(1);
+                }
+                directory_count++;
+            }
+            directories[record.directory_id] = data + offset;
+            directory_lengths[record.directory_id] = record.name_length;
+        } else if (record.type == JOURNAL_MOVE && record.directory_id < directory_count) {
+            if (move_count == move_capacity) {
+                move_capacity = move_capacity ? move_capacity * 2 : 1024;
+                JournalMove *grown = realloc(moves, sizeof(JournalMove) * move_capacity);
+                if (grown == NULL) {
+                    fprintf(stderr, "Memory allocation failed\n");
+                    exit(1);
+                }
+                moves = grown;
+            }
+            JournalMove *move = &moves[move_count];
+            move->directory = directories[record.directory_id];
+            move->directory_length = directory_lengths[record.directory_id];
+            move->name = data + offset;
+            move->name_length = record.name_length;
+            move->category = move->name + record.name_length;
+            move->category_length = record.category_length;
+            move->dest_name = move->category + record.category_length;
+            move->dest_length = record.dest_length;
+            move->position = move_count++;
+        } else if (record.type == JOURNAL_CATEGORY && record.directory_id < directory_count) {
+            JournalCategory *grown = realloc(created, sizeof(JournalCategory) * (created_count + 1));
+            if (grown == NULL) {
+                fprintf(stderr, "Memory allocation failed\n");
+                exit(1);
+            }
+            created = grown;
+            created[created_count].directory = directories[record.directory_id];
+            created[created_count].directory_length = directory_lengths[record.directory_id];
+            created[created_count].category = data + offset;
+            created[created_count].category_length = record.name_length;
+            created_count++;
+        } else {
+            torn = true;
+            break;
+        }
+        offset += body;
+    }
+
+    if (torn) {
+        fprintf(stderr, "Journal %s ends in a damaged record; undoing everything before it\n", path);
+    }
+
+    // Reverse order within each directory, and one open per directory
+    qsort(moves, move_count, sizeof(JournalMove), compare_for_undo);
+
+    MoveStats stats = {0};
+    size_t start = 0;
+    while (start < move_count) {
+        size_t end = start + 1;
+        while (end < move_count && compare_directories(&moves[start], &moves[end]) == 0) end++;
+        undo_directory(moves + start, end - start, created, created_count, &stats);
+        start = end;
+    }
+
+    printf("Restored %zu file(s), failed %zu\n", stats.moved, stats.failed);
+
+    free(moves);
+    free(created);
+    free(directories);
+    free(directory_lengths);
+    munmap(base, length);
+    return stats.failed == 0 ? 0 : -1;
+}
@@ -0,0 +1,80 @@
+/* =============================================================================
+   Program Name: FancyD (Fancy Directory Organizer)
+   Author: Nicholas D. Redmond (3A3YN1CKY)
+   Date: 8/13/2024
+   Description: Simple program to organize files in a directory.
+   ============================================================================= */
+
+#ifndef MOVE_JOURNAL_H
+#define MOVE_JOURNAL_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <fancy.h>
+
+#define MOVE_JOURNAL_MAGIC "FDJRNL"
+#define MOVE_JOURNAL_VERSION 1
+#define MOVE_JOURNAL_BUFFER_SIZE (64 * 1024)
+
+#define JOURNAL_DIRECTORY 'D'
+#define JOURNAL_MOVE 'M'
+#define JOURNAL_CATEGORY 'C'
+
+// A journal is a header followed by records, only ever appended to.
+// A directory record gives an id to an absolute path the first time that
+// directory is used:
+//
+//   MoveJournalRecord{type 'D', directory_id, name_length}  path
+//
+// and every completed move is
+//
+//   MoveJournalRecord{type 'M', directory_id, name_length, category_length, dest_length}
+//   name  category  dest_name
+//
+// meaning directory/name is now directory/category/dest_name. A category
+// folder the run had to create is noted once, so undo removes only those:
+//
+//   MoveJournalRecord{type 'C', directory_id, name_length}  category
+//
+// Strings are
+// stored without terminators. Records are buffered, so a crash can lose
+// the last MOVE_JOURNAL_BUFFER_SIZE bytes; a torn record at the end is
+// ignored when the journal is read back.
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+} MoveJournalHeader;
+
+typedef struct {
+    uint8_t type;
+    uint8_t reserved;
+    uint16_t category_length;
+    uint32_t directory_id;
+    uint32_t name_length;
+    uint32_t dest_length;
+} MoveJournalRecord;
+
+typedef struct {
+    char *directory;            // as the caller spelled it
+    uint32_t id;
+} JournalDirectory;
+
+typedef struct MoveJournal {
+    FILE *file;
+    pthread_mutex_t lock;       // move workers record from several threads
+    JournalDirectory *directories;
+    size_t directory_capacity;  // power of two, open addressing
+    uint32_t directory_count;
+    bool failed;
+} MoveJournal;
+
+int move_journal_open(MoveJournal *journal, const char *path);
+void journal_move(const char *directory, const char *name, const char *category, const char *dest_name);
+void journal_category_created(const char *directory, const char *category);
+int move_journal_close(MoveJournal *journal);
+int undo_move_journal(const char *path);
+
+extern MoveJournal *move_journal;
+
+#endif // MOVE_JOURNAL_H
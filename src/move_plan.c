@@ -0,0 +1,233 @@
+/* =============================================================================
+   Program Name: FancyD (Fancy Directory Organizer)
+   Author: Nicholas D. Redmond (3A3YN1CKY)
+   Date: 8/13/2024
+   Description: Simple program to organize files in a directory.
+   ============================================================================= */
+
+#include <move_plan.h>
+#include <config_writer.h>
+
+MovePlan *move_plan = NULL;
+
+int move_plan_open(MovePlan *plan, const char *path) {
+    memset(plan, 0, sizeof(*plan));
+
+    if (strcmp(path, "-") == 0) {
+        plan->file = stdout;
+    } else {
+        plan->file = fopen(path, "w");
+        if (plan->file == NULL) {
+            fprintf(stderr, "Unable to create plan file %s: %s\n", path, strerror(errno));
+            return -1;
+        }
+        plan->owns_file = true;
+        setvbuf(plan->file, NULL, _IOFBF, CONFIG_WRITE_BUFFER_SIZE);
+    }
+
+    pthread_mutex_init(&plan->lock, NULL);
+    return 0;
+}
+
+static const char *planned_category(const FileEntry *entry, bool handle_misc) {
+    if (entry->category != NULL) return entry->category;
+    return handle_misc ? "misc" : NULL;
+}
+
+MoveStats move_plan_record(MovePlan *plan, const char *directory, const FileBatch *batch, bool handle_misc) {
+    MoveStats stats = {0};
+
+    char resolved[MAX_PATH];
+    const char *path = realpath(directory, resolved) != NULL ? resolved : directory;
+
+    // One line per category; there are only ever a handful per directory
+    const char **categories = NULL;
+    size_t category_total = 0;
+    for (size_t i = 0; i < batch->count; i++) {
+        const char *category = planned_category(&batch->entries[i], handle_misc);
+        if (category == NULL) {
+            stats.skipped++;
+            continue;
+        }
+
+        size_t c;
+        for (c = 0; c < category_total && strcmp(categories[c], category) != 0; c++);
+        if (c == category_total) {
+            const char **grown = realloc(categories, sizeof(char *) * (category_total + 1));
+            if (grown == NULL) {
+                fprintf(stderr, "Memory allocation failed\n");
+                exit(1);
+            }
+            categories = grown;
+            categories[category_total++] = category;
+        }
+    }
+
+    pthread_mutex_lock(&plan->lock);
+    for (size_t c = 0; c < category_total; c++) {
+        fputs("{\"directory\":", plan->file);
+        write_json_string(plan->file, path);
+        fputs(",\"category\":", plan->file);
+        write_json_string(plan->file, categories[c]);
+        fputs(",\"files\":[", plan->file);
+
+        bool first = true;
+        for (size_t i = 0; i < batch->count; i++) {
+            const char *category = planned_category(&batch->entries[i], handle_misc);
+            if (category == NULL || strcmp(category, categories[c]) != 0) continue;
+
+            if (!first) putc(',', plan->file);
+            write_json_string(plan->file, batch->names + batch->entries[i].name_offset);
+            first = false;
+            stats.moved++;
+        }
+        fputs("]}\n", plan->file);
+    }
+    plan->moves += stats.moved;
+    plan->skipped += stats.skipped;
+    pthread_mutex_unlock(&plan->lock);
+
+    free(categories);
+    return stats;
+}
+
+int move_plan_close(MovePlan *plan) {
+    bool ok = fflush(plan->file) == 0 && !ferror(plan->file);
+    if (plan->owns_file) {
+        ok = fclose(plan->file) == 0 && ok;
+    }
+    pthread_mutex_destroy(&plan->lock);
+
+    if (!ok) {
+        fprintf(stderr, "Failed to write move plan\n");
+        return -1;
+    }
+    // stdout may be the plan itself, so the summary goes to stderr
+    fprintf(stderr, "Planned %zu move(s), %zu file(s) left in place\n", plan->moves, plan->skipped);
+    return 0;
+}
+
+// Checks one plan line without acting on it
+static cJSON *parse_plan_line(const char *line) {
+    cJSON *json = cJSON_Parse(line);
+    if (json == NULL) return NULL;
+
+    cJSON *directory = cJSON_GetObjectItemCaseSensitive(json, "directory");
+    cJSON *category = cJSON_GetObjectItemCaseSensitive(json, "category");
+    cJSON *files = cJSON_GetObjectItemCaseSensitive(json, "files");
+    bool valid = cJSON_IsString(directory) && directory->valuestring[0] != '\0' &&
+                 cJSON_IsString(category) && is_plain_name(category->valuestring) &&
+                 cJSON_IsArray(files);
+
+    cJSON *file;
+    cJSON_ArrayForEach(file, files) {
+        if (!valid) break;
+        valid = cJSON_IsString(file) && is_plain_name(file->valuestring);
+    }
+
+    if (!valid) {
+        cJSON_Delete(json);
+        return NULL;
+    }
+    return json;
+}
+
+static void apply_batch(int dir_fd, const char *directory, FileBatch *batch, MoveStats *total) {
+    if (batch->count > 0) {
+        MoveStats stats = process_file_batch(dir_fd, directory, batch, false);
+        total->moved += stats.moved;
+        total->skipped += stats.skipped;
+        total->failed += stats.failed;
+    }
+    free_file_batch(batch);
+    memset(batch, 0, sizeof(*batch));
+}
+
+int apply_move_plan(const char *path) {
+    char *content = read_file_content(path);
+    if (content == NULL) {
+        fprintf(stderr, "Failed to read plan: %s\n", path);
+        return -1;
+    }
+
+    // Parse and check every line first, so a damaged plan doesn't get
+    // applied halfway; the parsed entries are what gets applied
+    cJSON **entries = NULL;
+    size_t entry_count = 0;
+    size_t line_number = 0;
+    for (char *next = content; next != NULL; ) {
+        char *line = next;
+        next = strchr(line, '\n');
+        if (next != NULL) *next++ = '\0';
+        line_number++;
+
+        if (strspn(line, " \t\r") == strlen(line)) continue;
+
+        cJSON *json = parse_plan_line(line);
+        if (json == NULL) {
+            fprintf(stderr, "Plan line %zu is not a valid entry, nothing was moved\n", line_number);
+            for (size_t i = 0; i < entry_count; i++) cJSON_Delete(entries[i]);
+            free(entries);
+            free(content);
+            return -1;
+        }
+
+        cJSON **grown = realloc(entries, sizeof(cJSON *) * (entry_count + 1));
+        if (grown == NULL) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        entries = grown;
+        entries[entry_count++] = json;
+    }
+    free(content);
+
+    // Categories go through the intern table so the move paths can match them by pointer
+    free_existing_mappings();
+    initialize_mappings();
+
+    MoveStats total = {0};
+    FileBatch batch = {0};
+    char *directory = NULL;
+    int dir_fd = -1;
+
+    // Consecutive lines for the same directory become one batch
+    for (size_t i = 0; i < entry_count; i++) {
+        cJSON *json = entries[i];
+        const char *line_directory = cJSON_GetObjectItemCaseSensitive(json, "directory")->valuestring;
+        if (directory == NULL || strcmp(directory, line_directory) != 0) {
+            apply_batch(dir_fd, directory, &batch, &total);
+            if (dir_fd != -1) close(dir_fd);
+            free(directory);
+
+            directory = strdup(line_directory);
+            if (directory == NULL) {
+                fprintf(stderr, "Memory allocation failed\n");
+                exit(1);
+            }
+            dir_fd = open(directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (dir_fd == -1) {
+                fprintf(stderr, "Unable to open directory: %s\n", directory);
+            }
+        }
+
+        const char *category = intern_category(cJSON_GetObjectItemCaseSensitive(json, "category")->valuestring);
+        cJSON *file;
+        cJSON_ArrayForEach(file, cJSON_GetObjectItemCaseSensitive(json, "files")) {
+            if (dir_fd == -1) {
+                total.failed++;
+            } else {
+                add_file_to_batch(&batch, file->valuestring, category);
+            }
+        }
+        cJSON_Delete(json);
+    }
+
+    apply_batch(dir_fd, directory, &batch, &total);
+    if (dir_fd != -1) close(dir_fd);
+    free(directory);
+    free(entries);
+
+    print_move_summary(&total);
+    return total.failed == 0 ? 0 : -1;
+}
@@ -0,0 +1,36 @@
+/* =============================================================================
+   Program Name: FancyD (Fancy Directory Organizer)
+   Author: Nicholas D. Redmond (3A3YN1CKY)
+   Date: 8/13/2024
+   Description: Simple program to organize files in a directory.
+   ============================================================================= */
+
+#ifndef MOVE_PLAN_H
+#define MOVE_PLAN_H
+
+#include <pthread.h>
+#include <fancy.h>
+
+// A move plan is JSON lines, one line per directory and category:
+//
+//   {"directory":"/abs/path","category":"Images","files":["a.png","b.jpg"]}
+//
+// Directories are absolute so a plan can be applied from anywhere.
+// While move_plan is set, every batch that would have been moved is
+// written here instead and the filesystem is left alone.
+typedef struct MovePlan {
+    FILE *file;
+    bool owns_file;
+    pthread_mutex_t lock;       // recursive walks record from several threads
+    size_t moves;
+    size_t skipped;
+} MovePlan;
+
+int move_plan_open(MovePlan *plan, const char *path);
+MoveStats move_plan_record(MovePlan *plan, const char *directory, const FileBatch *batch, bool handle_misc);
+int move_plan_close(MovePlan *plan);
+int apply_move_plan(const char *path);
+
+extern MovePlan *move_plan;
+
+#endif // MOVE_PLAN_H
@@ -0,0 +1,252 @@
+/* =============================================================================
+   Program Name: FancyD (Fancy Directory Organizer)
+   Author: Nicholas D. Redmond (3A3YN1CKY)
+   Date: 8/13/2024
+   Description: Simple program to organize files in a directory.
+   ============================================================================= */
+
+#include <move_pool.h>
+#include <category_cache.h>
+#include <collision.h>
+#include <pthread.h>
+#include <stdint.h>
+
+// Idle workers sleep on `ready` until the scanner pushes or finishes;
+// generation changes on every wakeup so none can be missed
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    atomic_ulong generation;
+    atomic_bool scan_done;
+} MoveWakeup;
+
+typedef struct {
+    MoveQueue *queue;
+    const char *directory;
+    const FileBatch *batch;
+    int dir_fd;
+    CategoryDir *const *category_dirs;
+    MoveWakeup *wakeup;
+    MoveStats stats;
+    pthread_t thread;
+} MoveWorker;
+
+static void move_wakeup(MoveWakeup *wakeup, bool all) {
+    pthread_mutex_lock(&wakeup->lock);
+    atomic_fetch_add(&wakeup->generation, 1);
+    if (all) {
+        pthread_cond_broadcast(&wakeup->ready);
+    } else {
+        pthread_cond_signal(&wakeup->ready);
+    }
+    pthread_mutex_unlock(&wakeup->lock);
+}
+
+int move_queue_init(MoveQueue *queue, size_t capacity) {
+    queue->cells = malloc(sizeof(MoveQueueCell) * capacity);
+    if (queue->cells == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return -1;
+    }
+    for (size_t i = 0; i < capacity; i++) {
+        atomic_init(&queue->cells[i].sequence, i);
+    }
+    queue->mask = capacity - 1;
+    atomic_init(&queue->enqueue_pos, 0);
+    atomic_init(&queue->dequeue_pos, 0);
+    return 0;
+}
+
+bool move_queue_push(MoveQueue *queue, size_t value) {
+    size_t pos = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed);
+    MoveQueueCell *cell;
+
+    for (;;) {
+        cell = &queue->cells[pos & queue->mask];
+        size_t seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&queue->enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false; // Full
+        } else {
+            pos = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed);
+        }
+    }
+
+    cell->value = value;
+    atomic_store_explicit(&cell->sequence, pos + 1, memory_order_release);
+    return true;
+}
+
+bool move_queue_pop(MoveQueue *queue, size_t *value) {
+    size_t pos = atomic_load_explicit(&queue->dequeue_pos, memory_order_relaxed);
+    MoveQueueCell *cell;
+
+    for (;;) {
+        cell = &queue->cells[pos & queue->mask];
+        size_t seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&queue->dequeue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false; // Empty
+        } else {
+            pos = atomic_load_explicit(&queue->dequeue_pos, memory_order_relaxed);
+        }
+    }
+
+    *value = cell->value;
+    atomic_store_explicit(&cell->sequence, pos + queue->mask + 1, memory_order_release);
+    return true;
+}
+
+void move_queue_destroy(MoveQueue *queue) {
+    free(queue->cells);
+    queue->cells = NULL;
+}
+
+static void* move_worker_main(void *arg) {
+    MoveWorker *worker = arg;
+    MoveWakeup *wakeup = worker->wakeup;
+    size_t index;
+
+    for (;;) {
+        // Read before popping, so a push that lands after an empty pop
+        // still shows up as a changed generation
+        unsigned long generation = atomic_load(&wakeup->generation);
+        if (!move_queue_pop(worker->queue, &index)) {
+            if (!atomic_load(&wakeup->scan_done)) {
+                pthread_mutex_lock(&wakeup->lock);
+                while (atomic_load(&wakeup->generation) == generation && !atomic_load(&wakeup->scan_done)) {
+                    pthread_cond_wait(&wakeup->ready, &wakeup->lock);
+                }
+                pthread_mutex_unlock(&wakeup->lock);
+                continue;
+            }
+            // The scanner may have pushed right before it flagged completion
+            if (!move_queue_pop(worker->queue, &index)) break;
+        }
+
+        const FileEntry *entry = &worker->batch->entries[index];
+        const char *name = worker->batch->names + entry->name_offset;
+        move_into_category(worker->dir_fd, worker->directory, name, worker->category_dirs[index], &worker->stats);
+    }
+
+    return NULL;
+}
+
+MoveStats run_move_pool(int dir_fd, const char *directory, const FileBatch *batch, bool handle_misc, int worker_count) {
+    MoveStats totals = {0};
+    MoveQueue queue;
+    if (move_queue_init(&queue, MOVE_QUEUE_CAPACITY) != 0) {
+        totals.failed = batch->count;
+        return totals;
+    }
+
+    CategoryCache cache;
+    category_cache_init(&cache, dir_fd, directory);
+
+    // Filled by the scanner before each push, so workers never touch the cache
+    CategoryDir **category_dirs = malloc(sizeof(CategoryDir *) * (batch->count ? batch->count : 1));
+    if (category_dirs == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+
+    MoveWakeup wakeup;
+    pthread_mutex_init(&wakeup.lock, NULL);
+    pthread_cond_init(&wakeup.ready, NULL);
+    atomic_init(&wakeup.generation, 0);
+    atomic_init(&wakeup.scan_done, false);
+
+    MoveWorker *workers = calloc(worker_count, sizeof(MoveWorker));
+    if (workers == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+
+    const char *misc_category = handle_misc ? intern_category("misc") : NULL;
+
+    int started = 0;
+    for (int i = 0; i < worker_count; i++) {
+        workers[i].queue = &queue;
+        workers[i].directory = directory;
+        workers[i].batch = batch;
+        workers[i].dir_fd = dir_fd;
+        workers[i].category_dirs = category_dirs;
+        workers[i].wakeup = &wakeup;
+        if (pthread_create(&workers[i].thread, NULL, move_worker_main, &workers[i]) != 0) {
+            fprintf(stderr, "Failed to start worker thread %d\n", i);
+            break;
+        }
+        started++;
+    }
+
+    if (started == 0) {
+        pthread_cond_destroy(&wakeup.ready);
+        pthread_mutex_destroy(&wakeup.lock);
+        free(category_dirs);
+        free(workers);
+        category_cache_destroy(&cache);
+        move_queue_destroy(&queue);
+        return move_batch_serially(dir_fd, directory, batch, handle_misc);
+    }
+
+    for (size_t i = 0; i < batch->count; i++) {
+        const char *category = batch->entries[i].category ? batch->entries[i].category : misc_category;
+
+        if (category == NULL) {
+            if (verbose) {
+                printf("Skipping uncategorized file: %s\n", batch->names + batch->entries[i].name_offset);
+            }
+            totals.skipped++;
+            continue;
+        }
+
+        // Each category directory is created once, here, before any worker touches it
+        category_dirs[i] = category_cache_get(&cache, category);
+        if (category_dirs[i]->fd == -1) {
+            totals.failed++;
+            continue;
+        }
+
+        // With the queue full the workers are all busy, so the scanner
+        // does this one itself rather than waiting for room
+        if (!move_queue_push(&queue, i)) {
+            const char *name = batch->names + batch->entries[i].name_offset;
+            move_into_category(dir_fd, directory, name, category_dirs[i], &totals);
+            continue;
+        }
+        move_wakeup(&wakeup, false);
+    }
+
+    atomic_store(&wakeup.scan_done, true);
+    move_wakeup(&wakeup, true);
+
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+
+    for (int i = 0; i < worker_count; i++) {
+        totals.moved += workers[i].stats.moved;
+        totals.skipped += workers[i].stats.skipped;
+        totals.failed += workers[i].stats.failed;
+    }
+
+    pthread_cond_destroy(&wakeup.ready);
+    pthread_mutex_destroy(&wakeup.lock);
+    free(category_dirs);
+    free(workers);
+    category_cache_destroy(&cache);
+    move_queue_destroy(&queue);
+    return totals;
+}
@@ -0,0 +1,39 @@
+/* =============================================================================
+   Program Name: FancyD (Fancy Directory Organizer)
+   Author: Nicholas D. Redmond (3A3YN1CKY)
+   Date: 8/13/2024
+   Description: Simple program to organize files in a directory.
+   ============================================================================= */
+
+#ifndef MOVE_POOL_H
+#define MOVE_POOL_H
+
+#include <stdatomic.h>
+#include <fancy.h>
+
+#define MOVE_QUEUE_CAPACITY 4096
+#define MAX_JOBS 256
+
+// Bounded multi-producer/multi-consumer queue of batch indices. Each cell
+// carries a sequence number so producers and consumers can claim slots
+// with a single compare-and-swap and never take a lock.
+typedef struct {
+    atomic_size_t sequence;
+    size_t value;
+} MoveQueueCell;
+
+typedef struct {
+    MoveQueueCell *cells;
+    size_t mask;
+    atomic_size_t enqueue_pos;
+    atomic_size_t dequeue_pos;
+} MoveQueue;
+
+int move_queue_init(MoveQueue *queue, size_t capacity);
+bool move_queue_push(MoveQueue *queue, size_t value);
+bool move_queue_pop(MoveQueue *queue, size_t *value);
+void move_queue_destroy(MoveQueue *queue);
+
+MoveStats run_move_pool(int dir_fd, const char *directory, const FileBatch *batch, bool handle_misc, int worker_count);
+
+#endif // MOVE_POOL_H
@@ -0,0 +1,287 @@
+/* =============================================================================
+   Program Name: FancyD (Fancy Directory Organizer)
+   Author: Nicholas D. Redmond (3A3YN1CKY)
+   Date: 8/13/2024
+   Description: Simple program to organize files in a directory.
+   ============================================================================= */
+
+#include <rule_cache.h>
+#include <sys/mman.h>
+
+// While the rules come from the cache, extension_index points straight
+// into the read-only mapping and the strings are never copied
+bool index_is_mapped = false;
+void *rule_cache_base = NULL;
+size_t rule_cache_length = 0;
+
+typedef struct {
+    char *data;
+    size_t size;
+    size_t capacity;
+} ByteBuffer;
+
+static void buffer_append(ByteBuffer *buffer, const void *data, size_t len) {
+    if (len == 0) return;
+    if (buffer->size + len > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity * 2 : 4096;
+        while (capacity < buffer->size + len) capacity *= 2;
+        char *grown = realloc(buffer->data, capacity);
+        if (grown == NULL) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        buffer->data = grown;
+        buffer->capacity = capacity;
+    }
+    memcpy(buffer->data + buffer->size, data, len);
+    buffer->size += len;
+}
+
+static uint32_t pool_add(ByteBuffer *pool, const char *str) {
+    uint32_t offset = (uint32_t)pool->size;
+    buffer_append(pool, str, strlen(str) + 1);
+    return offset;
+}
+
+static int cache_path(const char *config_folder, char *path, size_t size) {
+    int n = snprintf(path, size, "%s/%s", config_folder, RULE_CACHE_FILE);
+    return n > 0 && (size_t)n < size ? 0 : -1;
+}
+
+// Checks that the set of *_config.json files and their mtimes/sizes match
+// what the cache was built from
+static bool sources_match(const char *config_folder, const RuleCacheSource *sources,
+                          uint32_t source_count, const char *strings) {
+    DIR *dir = opendir(config_folder);
+    if (dir == NULL) return false;
+
+    uint32_t seen = 0;
+    bool match = true;
+    struct dirent *ent;
+    while (match && (ent = readdir(dir)) != NULL) {
+        if (!is_config_file(ent->d_name)) continue;
+
+        struct stat st;
+        if (fstatat(dirfd(dir), ent->d_name, &st, 0) != 0) {
+            match = false;
+            break;
+        }
+
+        match = false;
+        for (uint32_t i = 0; i < source_count; i++) {
+            if (strcmp(strings + sources[i].name_offset, ent->d_name) != 0) continue;
+            match = sources[i].size == (uint64_t)st.st_size &&
+                    sources[i].mtime_sec == (int64_t)st.st_mtim.tv_sec &&
+                    sources[i].mtime_nsec == (int64_t)st.st_mtim.tv_nsec;
+            break;
+        }
+        seen++;
+    }
+
+    closedir(dir);
+    return match && seen == source_count;
+}
+
+// Checks every offset and index slot against the sections they point into,
+// so a truncated or corrupted cache falls back to parsing the JSON instead
+// of reading outside the mapping
+static bool offsets_valid(const RuleCacheHeader *header, const char *base, size_t sources_off,
+                          size_t mappings_off, size_t categories_off, size_t index_off,
+                          const char *strings) {
+    uint64_t strings_size = header->strings_size;
+    // A terminated pool means any in-range offset yields a terminated string
+    if (strings_size == 0 || strings[strings_size - 1] != '\0') return false;
+
+    const RuleCacheSource *sources = (const RuleCacheSource *)(base + sources_off);
+    for (uint32_t i = 0; i < header->source_count; i++) {
+        if (sources[i].name_offset >= strings_size) return false;
+    }
+
+    const RuleCacheMapping *cached = (const RuleCacheMapping *)(base + mappings_off);
+    for (uint32_t i = 0; i < header->mapping_count; i++) {
+        if (cached[i].extension_offset >= strings_size ||
+            cached[i].category_offset >= strings_size) return false;
+    }
+
+    const uint32_t *categories = (const uint32_t *)(base + categories_off);
+    for (uint32_t i = 0; i < header->category_count; i++) {
+        if (categories[i] >= strings_size) return false;
+    }
+
+    // -1 marks an empty slot; anything else must name a mapping
+    const int32_t *index = (const int32_t *)(base + index_off);
+    for (uint32_t i = 0; i < header->index_capacity; i++) {
+        if (index[i] < -1 || index[i] >= (int64_t)header->mapping_count) return false;
+    }
+    return true;
+}
+
+int load_rule_cache(const char *config_folder) {
+    char path[MAX_PATH];
+    if (cache_path(config_folder, path, sizeof(path)) != 0) return -1;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(RuleCacheHeader)) {
+        close(fd);
+        return -1;
+    }
+
+    void *base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return -1;
+
+    const RuleCacheHeader *header = base;
+    size_t length = st.st_size;
+    size_t sources_off = sizeof(RuleCacheHeader);
+    size_t mappings_off = sources_off + sizeof(RuleCacheSource) * (size_t)header->source_count;
+    size_t categories_off = mappings_off + sizeof(RuleCacheMapping) * (size_t)header->mapping_count;
+    size_t index_off = categories_off + sizeof(uint32_t) * (size_t)header->category_count;
+    size_t strings_off = index_off + sizeof(int32_t) * (size_t)header->index_capacity;
+
+    bool valid = memcmp(header->magic, RULE_CACHE_MAGIC, sizeof(RULE_CACHE_MAGIC)) == 0 &&
+                 header->version == RULE_CACHE_VERSION &&
+                 header->word_size == sizeof(long) &&
+                 header->index_capacity > 0 &&
+                 (header->index_capacity & (header->index_capacity - 1)) == 0 &&
+                 strings_off <= length && header->strings_size == length - strings_off;
+
+    const char *strings = (const char *)base + strings_off;
+    if (!valid || !offsets_valid(header, base, sources_off, mappings_off, categories_off, index_off, strings) ||
+        !sources_match(config_folder, (const RuleCacheSource *)((char *)base + sources_off),
+                                 header->source_count, strings)) {
+        munmap(base, length);
+        return -1;
+    }
+
+    const RuleCacheMapping *cached = (const RuleCacheMapping *)((char *)base + mappings_off);
+    const uint32_t *categories = (const uint32_t *)((char *)base + categories_off);
+
+    // Only the pointer table is materialized; strings and the index stay in the mapping
+    grow_mappings(header->mapping_count > INITIAL_MAPPING_CAPACITY ? (int)header->mapping_count : INITIAL_MAPPING_CAPACITY);
+    for (uint32_t i = 0; i < header->mapping_count; i++) {
+        mappings[i].extension = (char *)strings + cached[i].extension_offset;
+        mappings[i].category = (char *)strings + cached[i].category_offset;
+    }
+    mapping_count = header->mapping_count;
+
+    for (uint32_t i = 0; i < header->category_count; i++) {
+        insert_category(strings + categories[i], true);
+    }
+
+    free(extension_index);
+    extension_index = (int *)((char *)base + index_off);
+    index_capacity = header->index_capacity;
+    index_is_mapped = true;
+    rebuild_filename_rules();
+
+    rule_cache_base = base;
+    rule_cache_length = length;
+    return 0;
+}
+
+int write_rule_cache(const char *config_folder) {
+    ByteBuffer sources = {0};
+    ByteBuffer pool = {0};
+    ByteBuffer body = {0};
+    RuleCacheHeader header = {0};
+
+    DIR *dir = opendir(config_folder);
+    if (dir == NULL) return -1;
+
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        if (!is_config_file(ent->d_name)) continue;
+
+        struct stat st;
+        if (fstatat(dirfd(dir), ent->d_name, &st, 0) != 0) continue;
+
+        RuleCacheSource source = {0};
+        source.mtime_sec = st.st_mtim.tv_sec;
+        source.mtime_nsec = st.st_mtim.tv_nsec;
+        source.size = st.st_size;
+        source.name_offset = pool_add(&pool, ent->d_name);
+        buffer_append(&sources, &source, sizeof(source));
+        header.source_count++;
+    }
+    closedir(dir);
+
+    // Categories are interned, so each distinct pointer is one category
+    const char **category_ptrs = NULL;
+    uint32_t *category_offsets = NULL;
+    size_t category_total = 0;
+
+    for (int i = 0; i < mapping_count; i++) {
+        size_t c;
+        for (c = 0; c < category_total && category_ptrs[c] != mappings[i].category; c++);
+        if (c == category_total) {
+            category_ptrs = realloc(category_ptrs, sizeof(char *) * (category_total + 1));
+            category_offsets = realloc(category_offsets, sizeof(uint32_t) * (category_total + 1));
+            if (category_ptrs == NULL || category_offsets == NULL) {
+                fprintf(stderr, "Memory allocation failed\n");
+                exit(1);
+            }
+            category_ptrs[c] = mappings[i].category;
+            category_offsets[c] = pool_add(&pool, mappings[i].category);
+            category_total++;
+        }
+
+        RuleCacheMapping mapping;
+        mapping.extension_offset = pool_add(&pool, mappings[i].extension);
+        mapping.category_offset = category_offsets[c];
+        buffer_append(&body, &mapping, sizeof(mapping));
+    }
+
+    buffer_append(&body, category_offsets, sizeof(uint32_t) * category_total);
+    for (size_t i = 0; i < index_capacity; i++) {
+        int32_t slot = extension_index[i];
+        buffer_append(&body, &slot, sizeof(slot));
+    }
+
+    memcpy(header.magic, RULE_CACHE_MAGIC, sizeof(RULE_CACHE_MAGIC));
+    header.version = RULE_CACHE_VERSION;
+    header.word_size = sizeof(long);
+    header.mapping_count = mapping_count;
+    header.category_count = category_total;
+    header.index_capacity = index_capacity;
+    header.strings_size = pool.size;
+
+    // Write beside the real file and rename so readers never see half a cache
+    char path[MAX_PATH];
+    char temp_path[MAX_PATH];
+    int result = -1;
+    if (cache_path(config_folder, path, sizeof(path)) == 0 &&
+        snprintf(temp_path, sizeof(temp_path), "%s.%ld.tmp", path, (long)getpid()) < (int)sizeof(temp_path)) {
+        FILE *file = fopen(temp_path, "wb");
+        if (file) {
+            bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                      (sources.size == 0 || fwrite(sources.data, sources.size, 1, file) == 1) &&
+                      (body.size == 0 || fwrite(body.data, body.size, 1, file) == 1) &&
+                      (pool.size == 0 || fwrite(pool.data, pool.size, 1, file) == 1);
+            ok = fclose(file) == 0 && ok;
+            if (ok && rename(temp_path, path) == 0) {
+                result = 0;
+            } else {
+                remove(temp_path);
+            }
+        }
+    }
+
+    free(category_ptrs);
+    free(category_offsets);
+    free(sources.data);
+    free(pool.data);
+    free(body.data);
+    return result;
+}
+
+void release_rule_cache() {
+    if (rule_cache_base != NULL) {
+        munmap(rule_cache_base, rule_cache_length);
+        rule_cache_base = NULL;
+        rule_cache_length = 0;
+    }
+    index_is_mapped = false;
+}
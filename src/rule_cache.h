@@ -0,0 +1,59 @@
+/* =============================================================================
+   Program Name: FancyD (Fancy Directory Organizer)
+   Author: Nicholas D. Redmond (3A3YN1CKY)
+   Date: 8/13/2024
+   Description: Simple program to organize files in a directory.
+   ============================================================================= */
+
+#ifndef RULE_CACHE_H
+#define RULE_CACHE_H
+
+#include <stdint.h>
+#include <fancy.h>
+
+#define RULE_CACHE_FILE "rules.bin"
+#define RULE_CACHE_MAGIC "FDRULES"
+#define RULE_CACHE_VERSION 1
+
+// On-disk layout of ~/.fancyD/rules.bin. Everything after the header is a
+// flat array addressed by offset, so the file is usable straight out of
+// mmap: the extension index is the same open-addressing table load_configs
+// builds, and all strings live in one pool at the end.
+//
+//   RuleCacheHeader
+//   RuleCacheSource   sources[source_count]     one per *_config.json
+//   RuleCacheMapping  mappings[mapping_count]
+//   uint32_t          categories[category_count] (string offsets)
+//   int32_t           index[index_capacity]
+//   char              strings[strings_size]
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t word_size;
+    uint32_t source_count;
+    uint32_t mapping_count;
+    uint32_t category_count;
+    uint32_t index_capacity;
+    uint64_t strings_size;
+} RuleCacheHeader;
+
+typedef struct {
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint64_t size;
+    uint32_t name_offset;
+    uint32_t reserved;
+} RuleCacheSource;
+
+typedef struct {
+    uint32_t extension_offset;
+    uint32_t category_offset;
+} RuleCacheMapping;
+
+int load_rule_cache(const char *config_folder);
+int write_rule_cache(const char *config_folder);
+void release_rule_cache();
+
+extern bool index_is_mapped;
+
+#endif // RULE_CACHE_H
@@ -0,0 +1,253 @@
+/* =============================================================================
+   Program Name: FancyD (Fancy Directory Organizer)
+   Author: Nicholas D. Redmond (3A3YN1CKY)
+   Date: 8/13/2024
+   Description: Simple program to organize files in a directory.
+   ============================================================================= */
+
+#include <scan_state.h>
+#include <sys/mman.h>
+
+static uint64_t hash_bytes(uint64_t hash, const char *str) {
+    for (; *str; str++) {
+        hash ^= (unsigned char)*str;
+        hash *= 1099511628211ULL;
+    }
+    // Fold in the terminator so "ab"+"c" and "a"+"bc" differ
+    hash ^= 0xff;
+    hash *= 1099511628211ULL;
+    return hash;
+}
+
+static uint64_t rules_fingerprint() {
+    // Order-sensitive on purpose: if the rules load in a different order
+    // the worst case is one full scan
+    uint64_t hash = 14695981039346656037ULL;
+    for (int i = 0; i < mapping_count; i++) {
+        hash = hash_bytes(hash, mappings[i].extension);
+        hash = hash_bytes(hash, mappings[i].category);
+    }
+    return hash_bytes(hash, sniff_content ? "sniff" : "");
+}
+
+static uint32_t name_slot(const char *name, uint32_t capacity) {
+    return (uint32_t)(hash_bytes(14695981039346656037ULL, name) & (capacity - 1));
+}
+
+static void unmap_previous(ScanState *state) {
+    if (state->base != NULL) munmap(state->base, state->length);
+    state->base = NULL;
+    state->length = 0;
+    state->header = NULL;
+    state->table = NULL;
+    state->files = NULL;
+    state->strings = NULL;
+}
+
+static void map_previous(ScanState *state) {
+    int fd = open(state->path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ScanStateHeader)) {
+        close(fd);
+        return;
+    }
+
+    void *base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return;
+
+    state->base = base;
+    state->length = st.st_size;
+
+    const ScanStateHeader *header = base;
+    size_t table_off = sizeof(ScanStateHeader);
+    size_t files_off = table_off + sizeof(uint32_t) * (size_t)header->table_capacity;
+    size_t strings_off = files_off + sizeof(ScanStateFile) * (size_t)header->name_count;
+
+    // A different inode under the same name, or different rules, means
+    // nothing recorded here can be trusted
+    bool valid = memcmp(header->magic, SCAN_STATE_MAGIC, sizeof(SCAN_STATE_MAGIC)) == 0 &&
+                 header->version == SCAN_STATE_VERSION &&
+                 header->device == (uint64_t)state->dir_stat.st_dev &&
+                 header->inode == (uint64_t)state->dir_stat.st_ino &&
+                 header->rules_fingerprint == state->fingerprint &&
+                 header->table_capacity > 0 &&
+                 (header->table_capacity & (header->table_capacity - 1)) == 0 &&
+                 header->name_count < header->table_capacity &&
+                 files_off % sizeof(uint64_t) == 0 &&
+                 strings_off + header->strings_size == state->length &&
+                 (header->strings_size == 0 || ((const char *)base)[state->length - 1] == '\0');
+    if (!valid) {
+        unmap_previous(state);
+        return;
+    }
+
+    state->header = header;
+    state->table = (const uint32_t *)((const char *)base + table_off);
+    state->files = (const ScanStateFile *)((const char *)base + files_off);
+    state->strings = (const char *)base + strings_off;
+}
+
+int scan_state_open(ScanState *state, const char *config_folder, int dir_fd) {
+    memset(state, 0, sizeof(*state));
+
+    if (fstat(dir_fd, &state->dir_stat) != 0) return -1;
+    clock_gettime(CLOCK_REALTIME_COARSE, &state->run_start);
+    state->fingerprint = rules_fingerprint();
+
+    int n = snprintf(state->path, sizeof(state->path), "%s/%s", config_folder, SCAN_STATE_FOLDER);
+    if (n < 0 || (size_t)n >= sizeof(state->path)) return -1;
+    if (mkdir(state->path, 0755) != 0 && errno != EEXIST) return -1;
+
+    n = snprintf(state->path, sizeof(state->path), "%s/%s/%llx-%llx.bin", config_folder, SCAN_STATE_FOLDER,
+                 (unsigned long long)state->dir_stat.st_dev, (unsigned long long)state->dir_stat.st_ino);
+    if (n < 0 || (size_t)n >= sizeof(state->path)) return -1;
+
+    map_previous(state);
+    return 0;
+}
+
+bool scan_state_unchanged(const ScanState *state) {
+    return state->header != NULL && state->header->settled &&
+           state->header->mtime_sec == (int64_t)state->dir_stat.st_mtim.tv_sec &&
+           state->header->mtime_nsec == (int64_t)state->dir_stat.st_mtim.tv_nsec;
+}
+
+static bool same_file(const ScanStateFile *file, const struct stat *st) {
+    return file->inode == (uint64_t)st->st_ino && file->size == (uint64_t)st->st_size &&
+           file->mtime_sec == (int64_t)st->st_mtim.tv_sec && file->mtime_nsec == (int64_t)st->st_mtim.tv_nsec;
+}
+
+bool scan_state_skipped_before(const ScanState *state, int dir_fd, const char *name) {
+    if (state->header == NULL || state->header->name_count == 0) return false;
+
+    const ScanStateFile *file = NULL;
+    uint32_t capacity = state->header->table_capacity;
+    for (uint32_t slot = name_slot(name, capacity); state->table[slot] != 0; slot = (slot + 1) & (capacity - 1)) {
+        uint32_t index = state->table[slot] - 1;
+        if (index < state->header->name_count && state->files[index].name_offset < state->header->strings_size &&
+            strcmp(state->strings + state->files[index].name_offset, name) == 0) {
+            file = &state->files[index];
+            break;
+        }
+    }
+    if (file == NULL) return false;
+
+    // Only a lookup so far; the name alone says nothing about whether the
+    // file behind it was rewritten or swapped since
+    struct stat st;
+    return fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISREG(st.st_mode) && same_file(file, &st);
+}
+
+void scan_state_keep(ScanState *state, int dir_fd, const char *name) {
+    // A file that vanished during the run will be looked at fresh next time
+    struct stat st;
+    if (fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0 || !S_ISREG(st.st_mode)) return;
+
+    size_t len = strlen(name) + 1;
+
+    if (state->count == state->capacity) {
+        size_t capacity = state->capacity ? state->capacity * 2 : INITIAL_BATCH_CAPACITY;
+        ScanStateFile *files = realloc(state->files_kept, sizeof(ScanStateFile) * capacity);
+        if (!files) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        state->files_kept = files;
+        state->capacity = capacity;
+    }
+
+    if (state->names_used + len > state->names_size) {
+        size_t size = state->names_size ? state->names_size * 2 : INITIAL_BATCH_CAPACITY * 16;
+        while (size < state->names_used + len) size *= 2;
+        char *names = realloc(state->names, size);
+        if (!names) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        state->names = names;
+        state->names_size = size;
+    }
+
+    memcpy(state->names + state->names_used, name, len);
+    state->files_kept[state->count++] = (ScanStateFile){
+        .inode = st.st_ino,
+        .size = st.st_size,
+        .mtime_sec = st.st_mtim.tv_sec,
+        .mtime_nsec = st.st_mtim.tv_nsec,
+        .name_offset = (uint32_t)state->names_used,
+    };
+    state->names_used += len;
+}
+
+int scan_state_save(ScanState *state, int dir_fd, bool moved_files) {
+    if (state->names_used > UINT32_MAX - 1) return -1;
+
+    // Our own moves changed the directory, and anything else that changed
+    // it during the run might not have been seen; either way the next run
+    // has to look
+    struct stat st;
+    if (fstat(dir_fd, &st) != 0) return -1;
+
+    ScanStateHeader header = {0};
+    memcpy(header.magic, SCAN_STATE_MAGIC, sizeof(SCAN_STATE_MAGIC));
+    header.version = SCAN_STATE_VERSION;
+    header.settled = !moved_files && st.st_mtim.tv_sec + SCAN_STATE_SETTLE_SECONDS < state->run_start.tv_sec;
+    header.device = st.st_dev;
+    header.inode = st.st_ino;
+    header.mtime_sec = st.st_mtim.tv_sec;
+    header.mtime_nsec = st.st_mtim.tv_nsec;
+    header.rules_fingerprint = state->fingerprint;
+    header.name_count = state->count;
+    header.strings_size = state->names_used;
+
+    // Keep the table at most half full
+    header.table_capacity = 8;
+    while (header.table_capacity < state->count * 2) header.table_capacity *= 2;
+
+    uint32_t *table = calloc(header.table_capacity, sizeof(uint32_t));
+    if (table == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    for (size_t i = 0; i < state->count; i++) {
+        uint32_t slot = name_slot(state->names + state->files_kept[i].name_offset, header.table_capacity);
+        while (table[slot] != 0) slot = (slot + 1) & (header.table_capacity - 1);
+        table[slot] = (uint32_t)i + 1;
+    }
+
+    // Write beside the real file and rename so readers never see half a state
+    char temp_path[MAX_PATH];
+    int result = -1;
+    if (snprintf(temp_path, sizeof(temp_path), "%s.%ld.tmp", state->path, (long)getpid()) < (int)sizeof(temp_path)) {
+        FILE *file = fopen(temp_path, "wb");
+        if (file) {
+            bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                      fwrite(table, sizeof(uint32_t), header.table_capacity, file) == header.table_capacity &&
+                      (state->count == 0 ||
+                       fwrite(state->files_kept, sizeof(ScanStateFile), state->count, file) == state->count) &&
+                      (state->names_used == 0 || fwrite(state->names, state->names_used, 1, file) == 1);
+            ok = fclose(file) == 0 && ok;
+            if (ok && rename(temp_path, state->path) == 0) {
+                result = 0;
+            } else {
+                remove(temp_path);
+            }
+        }
+    }
+
+    free(table);
+    return result;
+}
+
+void scan_state_close(ScanState *state) {
+    unmap_previous(state);
+    free(state->names);
+    free(state->files_kept);
+    state->names = NULL;
+    state->files_kept = NULL;
+    state->count = state->capacity = 0;
+    state->names_used = state->names_size = 0;
+}
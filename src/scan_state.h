@@ -0,0 +1,90 @@
+/* =============================================================================
+   Program Name: FancyD (Fancy Directory Organizer)
+   Author: Nicholas D. Redmond (3A3YN1CKY)
+   Date: 8/13/2024
+   Description: Simple program to organize files in a directory.
+   ============================================================================= */
+
+#ifndef SCAN_STATE_H
+#define SCAN_STATE_H
+
+#include <stdint.h>
+#include <time.h>
+#include <fancy.h>
+
+#define SCAN_STATE_FOLDER "state"
+#define SCAN_STATE_MAGIC "FDSTATE"
+#define SCAN_STATE_VERSION 2
+
+// A directory only counts as settled once its mtime is this far behind the
+// start of the run, which covers filesystems with coarse timestamps
+#define SCAN_STATE_SETTLE_SECONDS 2
+
+// On-disk layout of ~/.fancyD/state/<dev>-<ino>.bin, one per organized
+// directory. Like rules.bin it is used straight out of mmap.
+//
+//   ScanStateHeader
+//   uint32_t        table[table_capacity]   open addressing, file index + 1, 0 = empty
+//   ScanStateFile   files[name_count]
+//   char            strings[strings_size]   names left in place by the last run
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t settled;           // nothing moved and the mtime predates the run
+    uint64_t device;
+    uint64_t inode;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint64_t rules_fingerprint;
+    uint32_t name_count;
+    uint32_t table_capacity;
+    uint64_t strings_size;
+} ScanStateHeader;
+
+// What a kept file looked like when it was left in place; any difference
+// means the file was rewritten or replaced and has to be classified again
+typedef struct {
+    uint64_t inode;
+    uint64_t size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint32_t name_offset;
+    uint32_t reserved;
+} ScanStateFile;
+
+// Remembers which files a run left in place because no rule matched them.
+// When the directory's mtime hasn't moved since a settled run there is
+// nothing to do at all; otherwise files that are still the same as last time
+// go back into the batch uncategorized without being classified again.
+// Any change to the rules or to --sniff throws the state away.
+typedef struct ScanState {
+    char path[MAX_PATH];
+    struct stat dir_stat;
+    struct timespec run_start;
+    uint64_t fingerprint;
+
+    // The previous run, mapped read-only; header is NULL when there is none
+    void *base;
+    size_t length;
+    const ScanStateHeader *header;
+    const uint32_t *table;
+    const ScanStateFile *files;
+    const char *strings;
+
+    // Names being collected for the next run
+    char *names;
+    size_t names_used;
+    size_t names_size;
+    ScanStateFile *files_kept;
+    size_t count;
+    size_t capacity;
+} ScanState;
+
+int scan_state_open(ScanState *state, const char *config_folder, int dir_fd);
+bool scan_state_unchanged(const ScanState *state);
+bool scan_state_skipped_before(const ScanState *state, int dir_fd, const char *name);
+void scan_state_keep(ScanState *state, int dir_fd, const char *name);
+int scan_state_save(ScanState *state, int dir_fd, bool moved_files);
+void scan_state_close(ScanState *state);
+
+#endif // SCAN_STATE_H
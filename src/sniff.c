@@ -0,0 +1,134 @@
+/* =============================================================================
+   Program Name: FancyD (Fancy Directory Organizer)
+   Author: Nicholas D. Redmond (3A3YN1CKY)
+   Date: 8/13/2024
+   Description: Simple program to organize files in a directory.
+   ============================================================================= */
+
+#include <sniff.h>
+#include <pthread.h>
+
+// Within one first byte, longer and more specific signatures come first
+static const MagicSignature signatures[] = {
+    {0, 8, "\x89PNG\r\n\x1a\n", 0, 0, NULL, ".png"},
+    {0, 3, "\xff\xd8\xff", 0, 0, NULL, ".jpg"},
+    {0, 2, "\xff\xfb", 0, 0, NULL, ".mp3"},
+    {0, 2, "\xff\xf3", 0, 0, NULL, ".mp3"},
+    {0, 2, "\xff\xf2", 0, 0, NULL, ".mp3"},
+    {0, 6, "GIF87a", 0, 0, NULL, ".gif"},
+    {0, 6, "GIF89a", 0, 0, NULL, ".gif"},
+    {0, 5, "%PDF-", 0, 0, NULL, ".pdf"},
+    {0, 4, "PK\x03\x04", 0, 0, NULL, ".zip"},
+    {0, 4, "PK\x05\x06", 0, 0, NULL, ".zip"},
+    {0, 2, "\x1f\x8b", 0, 0, NULL, ".gz"},
+    {0, 3, "BZh", 0, 0, NULL, ".bz2"},
+    {0, 6, "\xfd" "7zXZ\x00", 0, 0, NULL, ".xz"},
+    {0, 4, "\x28\xb5\x2f\xfd", 0, 0, NULL, ".zst"},
+    {0, 6, "7z\xbc\xaf\x27\x1c", 0, 0, NULL, ".7z"},
+    {0, 6, "Rar!\x1a\x07", 0, 0, NULL, ".rar"},
+    {0, 4, "\x7f" "ELF", 0, 0, NULL, ".elf"},
+    {0, 2, "MZ", 0, 0, NULL, ".exe"},
+    {0, 4, "RIFF", 8, 4, "WAVE", ".wav"},
+    {0, 4, "RIFF", 8, 4, "AVI ", ".avi"},
+    {0, 4, "RIFF", 8, 4, "WEBP", ".webp"},
+    {0, 4, "OggS", 0, 0, NULL, ".ogg"},
+    {0, 3, "ID3", 0, 0, NULL, ".mp3"},
+    {0, 4, "fLaC", 0, 0, NULL, ".flac"},
+    {0, 4, "\x1a\x45\xdf\xa3", 0, 0, NULL, ".mkv"},
+    {0, 4, "II*\x00", 0, 0, NULL, ".tiff"},
+    {0, 4, "MM\x00*", 0, 0, NULL, ".tiff"},
+    {0, 4, "8BPS", 0, 0, NULL, ".psd"},
+    {0, 5, "{\\rtf", 0, 0, NULL, ".rtf"},
+    {0, 16, "SQLite format 3\x00", 0, 0, NULL, ".sqlite"},
+    // Signatures that don't start at byte 0 are checked after the dispatch
+    {4, 4, "ftyp", 8, 4, "qt  ", ".mov"},
+    {4, 4, "ftyp", 8, 4, "M4A ", ".m4a"},
+    {4, 4, "ftyp", 0, 0, NULL, ".mp4"},
+    {257, 5, "ustar", 0, 0, NULL, ".tar"},
+};
+
+#define SIGNATURE_COUNT (sizeof(signatures) / sizeof(signatures[0]))
+
+// First-byte dispatch: signatures starting at offset 0 are bucketed by
+// their first byte, so most files are compared against one or two entries
+static unsigned char bucket_start[257];
+static unsigned char bucket_order[SIGNATURE_COUNT];
+static unsigned char offset_start;
+static pthread_once_t dispatch_once = PTHREAD_ONCE_INIT;
+
+static void build_dispatch() {
+    unsigned char counts[256] = {0};
+    size_t anchored = 0;
+    for (size_t i = 0; i < SIGNATURE_COUNT; i++) {
+        if (signatures[i].offset == 0) {
+            counts[(unsigned char)signatures[i].magic[0]]++;
+            anchored++;
+        }
+    }
+
+    bucket_start[0] = 0;
+    for (int b = 0; b < 256; b++) {
+        bucket_start[b + 1] = bucket_start[b] + counts[b];
+    }
+
+    unsigned char fill[256];
+    memcpy(fill, bucket_start, sizeof(fill));
+    size_t tail = anchored;
+    for (size_t i = 0; i < SIGNATURE_COUNT; i++) {
+        if (signatures[i].offset == 0) {
+            bucket_order[fill[(unsigned char)signatures[i].magic[0]]++] = (unsigned char)i;
+        } else {
+            bucket_order[tail++] = (unsigned char)i;
+        }
+    }
+    offset_start = (unsigned char)anchored;
+}
+
+static bool signature_matches(const MagicSignature *signature, const unsigned char *buffer, size_t length) {
+    if ((size_t)signature->offset + signature->length > length ||
+        memcmp(buffer + signature->offset, signature->magic, signature->length) != 0) {
+        return false;
+    }
+    if (signature->magic2 == NULL) return true;
+    return (size_t)signature->offset2 + signature->length2 <= length &&
+           memcmp(buffer + signature->offset2, signature->magic2, signature->length2) == 0;
+}
+
+const char *sniff_buffer(const unsigned char *buffer, size_t length) {
+    if (length == 0) return NULL;
+    pthread_once(&dispatch_once, build_dispatch);
+
+    for (unsigned i = bucket_start[buffer[0]]; i < bucket_start[buffer[0] + 1]; i++) {
+        const MagicSignature *signature = &signatures[bucket_order[i]];
+        if (signature_matches(signature, buffer, length)) return signature->extension;
+    }
+    for (size_t i = offset_start; i < SIGNATURE_COUNT; i++) {
+        const MagicSignature *signature = &signatures[bucket_order[i]];
+        if (signature_matches(signature, buffer, length)) return signature->extension;
+    }
+    return NULL;
+}
+
+const char *sniff_extension(int fd) {
+    unsigned char buffer[SNIFF_BYTES];
+    ssize_t n;
+    do {
+        n = pread(fd, buffer, sizeof(buffer), 0);
+    } while (n == -1 && errno == EINTR);
+
+    return n > 0 ? sniff_buffer(buffer, (size_t)n) : NULL;
+}
+
+const char *sniff_file_category(int dir_fd, const char *name) {
+    int fd = openat(dir_fd, name, O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_CLOEXEC);
+    if (fd == -1) return NULL;
+
+    const char *extension = sniff_extension(fd);
+    close(fd);
+
+    if (extension == NULL) return NULL;
+    if (verbose) {
+        printf("Sniffed %s as %s\n", name, extension);
+    }
+    return get_category_for_extension(extension);
+}
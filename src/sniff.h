@@ -0,0 +1,34 @@
+/* =============================================================================
+   Program Name: FancyD (Fancy Directory Organizer)
+   Author: Nicholas D. Redmond (3A3YN1CKY)
+   Date: 8/13/2024
+   Description: Simple program to organize files in a directory.
+   ============================================================================= */
+
+#ifndef SNIFF_H
+#define SNIFF_H
+
+#include <fancy.h>
+
+#define SNIFF_BYTES 512
+
+// A file type recognized by its leading bytes. Some formats need a second
+// check further in (RIFF containers, MP4 brands); those set magic2.
+typedef struct {
+    unsigned short offset;
+    unsigned char length;
+    const char *magic;
+    unsigned short offset2;
+    unsigned char length2;
+    const char *magic2;
+    const char *extension;
+} MagicSignature;
+
+// Reads at most SNIFF_BYTES from the start of the file with a single pread
+// and returns the extension its signature stands for (".png", ".pdf", ...),
+// or NULL. The category then comes from the normal extension mappings.
+const char *sniff_extension(int fd);
+const char *sniff_buffer(const unsigned char *buffer, size_t length);
+const char *sniff_file_category(int dir_fd, const char *name);
+
+#endif // SNIFF_H
@@ -0,0 +1,94 @@
+/* =============================================================================
+   Program Name: FancyD (Fancy Directory Organizer)
+   Author: Nicholas D. Redmond (3A3YN1CKY)
+   Date: 8/13/2024
+   Description: Simple program to organize files in a directory.
+   ============================================================================= */
+
+#include <suffix_trie.h>
+
+void suffix_trie_init(SuffixTrie *trie) {
+    memset(trie->root, 0xff, sizeof(trie->root));
+    trie->nodes = NULL;
+    trie->count = 0;
+    trie->capacity = 0;
+}
+
+static int new_node(SuffixTrie *trie, unsigned char label) {
+    if (trie->count == trie->capacity) {
+        size_t capacity = trie->capacity ? trie->capacity * 2 : 1024;
+        SuffixNode *nodes = realloc(trie->nodes, sizeof(SuffixNode) * capacity);
+        if (nodes == NULL) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        trie->nodes = nodes;
+        trie->capacity = capacity;
+    }
+
+    SuffixNode *node = &trie->nodes[trie->count];
+    node->first_child = -1;
+    node->next_sibling = -1;
+    node->category = NULL;
+    node->label = label;
+    return (int)trie->count++;
+}
+
+static int find_child(const SuffixTrie *trie, int parent, unsigned char label) {
+    int child = trie->nodes[parent].first_child;
+    while (child >= 0 && trie->nodes[child].label != label) {
+        child = trie->nodes[child].next_sibling;
+    }
+    return child;
+}
+
+void suffix_trie_set(SuffixTrie *trie, const char *extension, const char *category) {
+    // Only dotted extensions can line up with a dot in a filename
+    size_t len = strlen(extension);
+    if (len < 2 || extension[0] != '.') return;
+
+    unsigned char label = tolower((unsigned char)extension[len - 1]);
+    int node = trie->root[label];
+    if (node < 0) {
+        node = new_node(trie, label);
+        trie->root[label] = node;
+    }
+
+    for (size_t i = len - 1; i-- > 0; ) {
+        label = tolower((unsigned char)extension[i]);
+        int child = find_child(trie, node, label);
+        if (child < 0) {
+            // new_node may move the array, so link by index afterwards
+            child = new_node(trie, label);
+            trie->nodes[child].next_sibling = trie->nodes[node].first_child;
+            trie->nodes[node].first_child = child;
+        }
+        node = child;
+    }
+
+    trie->nodes[node].category = category;
+}
+
+const char *suffix_trie_match(const SuffixTrie *trie, const char *filename) {
+    size_t len = strlen(filename);
+    if (len < 2) return NULL;
+
+    const char *category = NULL;
+    int node = trie->root[(unsigned char)tolower((unsigned char)filename[len - 1])];
+
+    // A match only counts where the suffix starts at a dot that isn't the
+    // leading dot of a hidden file; the last one seen is the longest
+    for (size_t i = len - 1; node >= 0 && i > 0; ) {
+        i--;
+        node = find_child(trie, node, tolower((unsigned char)filename[i]));
+        if (node >= 0 && filename[i] == '.' && i > 0 && trie->nodes[node].category != NULL) {
+            category = trie->nodes[node].category;
+        }
+    }
+    return category;
+}
+
+void suffix_trie_destroy(SuffixTrie *trie) {
+    free(trie->nodes);
+    suffix_trie_init(trie);
+}
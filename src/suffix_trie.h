@@ -0,0 +1,38 @@
+/* =============================================================================
+   Program Name: FancyD (Fancy Directory Organizer)
+   Author: Nicholas D. Redmond (3A3YN1CKY)
+   Date: 8/13/2024
+   Description: Simple program to organize files in a directory.
+   ============================================================================= */
+
+#ifndef SUFFIX_TRIE_H
+#define SUFFIX_TRIE_H
+
+#include <fancy.h>
+
+typedef struct {
+    int first_child;
+    int next_sibling;
+    const char *category;   // set when a mapped extension ends here
+    unsigned char label;
+} SuffixNode;
+
+// Every mapped extension stored back to front and case-folded, so a
+// filename is classified by walking it from its last byte towards the
+// start. Compound extensions such as ".tar.gz" then win over ".gz" without
+// a second lookup. The first level is a direct table on the last byte.
+typedef struct {
+    int root[256];
+    SuffixNode *nodes;
+    size_t count;
+    size_t capacity;
+} SuffixTrie;
+
+void suffix_trie_init(SuffixTrie *trie);
+void suffix_trie_set(SuffixTrie *trie, const char *extension, const char *category);
+const char *suffix_trie_match(const SuffixTrie *trie, const char *filename);
+void suffix_trie_destroy(SuffixTrie *trie);
+
+extern SuffixTrie extension_trie;
+
+#endif // SUFFIX_TRIE_H
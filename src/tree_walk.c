@@ -0,0 +1,341 @@
+/* =============================================================================
+   Program Name: FancyD (Fancy Directory Organizer)
+   Author: Nicholas D. Redmond (3A3YN1CKY)
+   Date: 8/13/2024
+   Description: Simple program to organize files in a directory.
+   ============================================================================= */
+
+#include <tree_walk.h>
+#include <dir_reader.h>
+#include <move_plan.h>
+
+typedef struct TreeWalk TreeWalk;
+
+typedef struct {
+    TreeWalk *walk;
+    int id;
+    WalkDeque deque;
+    FileBatch batch;
+    MoveStats stats;
+    pthread_t thread;
+} WalkWorker;
+
+struct TreeWalk {
+    int root_fd;
+    const char *root;
+    bool ask_misc;
+    int misc_answer;            // -1 until asked, guarded by misc_lock
+    pthread_mutex_t misc_lock;
+    int max_depth;
+    WalkWorker *workers;
+    int worker_count;
+    atomic_size_t pending;
+
+    // Idle workers sleep here until a directory is queued or the walk ends;
+    // generation changes on every wakeup so none can be missed
+    pthread_mutex_t idle_lock;
+    pthread_cond_t work_available;
+    atomic_ulong generation;
+};
+
+static void wake_workers(TreeWalk *walk, bool all) {
+    pthread_mutex_lock(&walk->idle_lock);
+    atomic_fetch_add(&walk->generation, 1);
+    if (all) {
+        pthread_cond_broadcast(&walk->work_available);
+    } else {
+        pthread_cond_signal(&walk->work_available);
+    }
+    pthread_mutex_unlock(&walk->idle_lock);
+}
+
+static void deque_init(WalkDeque *deque) {
+    memset(deque, 0, sizeof(*deque));
+    pthread_mutex_init(&deque->lock, NULL);
+}
+
+static void deque_destroy(WalkDeque *deque) {
+    for (size_t i = deque->top; i < deque->bottom; i++) {
+        free(deque->tasks[i % deque->capacity].path);
+    }
+    free(deque->tasks);
+    pthread_mutex_destroy(&deque->lock);
+}
+
+static void deque_push(WalkDeque *deque, WalkTask task) {
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom - deque->top == deque->capacity) {
+        size_t capacity = deque->capacity ? deque->capacity * 2 : 64;
+        WalkTask *tasks = malloc(sizeof(WalkTask) * capacity);
+        if (tasks == NULL) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        for (size_t i = deque->top; i < deque->bottom; i++) {
+            tasks[i - deque->top] = deque->tasks[i % deque->capacity];
+        }
+        deque->bottom -= deque->top;
+        deque->top = 0;
+        free(deque->tasks);
+        deque->tasks = tasks;
+        deque->capacity = capacity;
+    }
+    deque->tasks[deque->bottom % deque->capacity] = task;
+    deque->bottom++;
+    pthread_mutex_unlock(&deque->lock);
+}
+
+static bool deque_pop_bottom(WalkDeque *deque, WalkTask *task) {
+    bool found = false;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom > deque->top) {
+        deque->bottom--;
+        *task = deque->tasks[deque->bottom % deque->capacity];
+        found = true;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static bool deque_steal_top(WalkDeque *deque, WalkTask *task) {
+    bool found = false;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom > deque->top) {
+        *task = deque->tasks[deque->top % deque->capacity];
+        deque->top++;
+        found = true;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static void push_directory(WalkWorker *worker, const char *parent, const char *name, int depth) {
+    size_t len = strlen(parent) + strlen(name) + 2;
+    char *path = malloc(len);
+    if (path == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    if (parent[0] == '\0') {
+        snprintf(path, len, "%s", name);
+    } else {
+        snprintf(path, len, "%s/%s", parent, name);
+    }
+
+    atomic_fetch_add(&worker->walk->pending, 1);
+    deque_push(&worker->deque, (WalkTask){ path, depth });
+    wake_workers(worker->walk, false);
+}
+
+// The misc question is asked the first time a directory needs the answer,
+// so trees where every file has a category never see it. Workers that
+// need it meanwhile wait for the reply.
+static bool misc_wanted(TreeWalk *walk) {
+    if (!walk->ask_misc) return false;
+
+    pthread_mutex_lock(&walk->misc_lock);
+    if (walk->misc_answer == -1) {
+        char response;
+        printf("Put uncategorized files in a 'misc' folder in each directory? (y/n): ");
+        fflush(stdout);
+        walk->misc_answer = scanf(" %c", &response) == 1 && (response == 'y' || response == 'Y');
+    }
+    bool wanted = walk->misc_answer == 1;
+    pthread_mutex_unlock(&walk->misc_lock);
+    return wanted;
+}
+
+static bool is_directory_entry(int dir_fd, const char *name, unsigned char d_type) {
+    if (d_type != DT_UNKNOWN) {
+        return d_type == DT_DIR;
+    }
+
+    struct stat st;
+    return fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(st.st_mode);
+}
+
+static void walk_directory(WalkWorker *worker, const WalkTask *task) {
+    TreeWalk *walk = worker->walk;
+    const char *relative = task->path[0] ? task->path : ".";
+
+    char display[MAX_PATH];
+    if (task->path[0]) {
+        snprintf(display, sizeof(display), "%s/%s", walk->root, task->path);
+    } else {
+        snprintf(display, sizeof(display), "%s", walk->root);
+    }
+
+    int dir_fd = openat(walk->root_fd, relative, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (dir_fd == -1) {
+        fprintf(stderr, "Unable to open directory: %s\n", display);
+        return;
+    }
+
+    DirReader reader;
+    if (dir_reader_open_fd(&reader, dir_fd, dir_buffer_size) != 0) {
+        fprintf(stderr, "Unable to read directory: %s\n", display);
+        close(dir_fd);
+        return;
+    }
+
+    FileBatch *batch = &worker->batch;
+    batch->count = 0;
+    batch->names_used = 0;
+    batch->has_uncategorized = false;
+
+    bool descend = walk->max_depth < 0 || task->depth < walk->max_depth;
+
+    DirEntry *entries;
+    long count;
+    while ((count = dir_reader_next_batch(&reader, &entries)) > 0) {
+        for (long i = 0; i < count; i++) {
+            const char *name = entries[i].name;
+            if (is_special_directory(name)) continue;
+
+            if (is_regular_entry(dir_fd, name, entries[i].d_type)) {
+                add_file_to_batch(batch, name, classify_file(dir_fd, name));
+                continue;
+            }
+
+            // Category folders are our own output; sorting them again would
+            // only shuffle files back into themselves
+            if (!descend || !is_directory_entry(dir_fd, name, entries[i].d_type)) continue;
+            if (is_category_name(name) || (strcmp(name, "misc") == 0 && misc_wanted(walk))) continue;
+
+            push_directory(worker, task->path, name, task->depth + 1);
+        }
+    }
+    dir_reader_close(&reader);
+
+    bool handle_misc = batch->has_uncategorized && misc_wanted(walk);
+    MoveStats stats = move_plan != NULL ? move_plan_record(move_plan, display, batch, handle_misc)
+                                        : move_batch_serially(dir_fd, display, batch, handle_misc);
+    worker->stats.moved += stats.moved;
+    worker->stats.skipped += stats.skipped;
+    worker->stats.failed += stats.failed;
+
+    close(dir_fd);
+}
+
+static bool find_work(WalkWorker *worker, WalkTask *task) {
+    if (deque_pop_bottom(&worker->deque, task)) {
+        return true;
+    }
+
+    TreeWalk *walk = worker->walk;
+    for (int i = 1; i < walk->worker_count; i++) {
+        WalkWorker *victim = &walk->workers[(worker->id + i) % walk->worker_count];
+        if (deque_steal_top(&victim->deque, task)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void* walk_worker_main(void *arg) {
+    WalkWorker *worker = arg;
+    TreeWalk *walk = worker->walk;
+    WalkTask task;
+
+    for (;;) {
+        // Read before looking, so a push that lands after the search fails
+        // still shows up as a changed generation
+        unsigned long generation = atomic_load(&walk->generation);
+        if (!find_work(worker, &task)) {
+            // Children are queued before their parent is retired, so zero
+            // pending really means the whole tree is done
+            pthread_mutex_lock(&walk->idle_lock);
+            while (atomic_load(&walk->generation) == generation && atomic_load(&walk->pending) != 0) {
+                pthread_cond_wait(&walk->work_available, &walk->idle_lock);
+            }
+            bool done = atomic_load(&walk->pending) == 0;
+            pthread_mutex_unlock(&walk->idle_lock);
+            if (done) break;
+            continue;
+        }
+
+        walk_directory(worker, &task);
+        free(task.path);
+        if (atomic_fetch_sub(&walk->pending, 1) == 1) {
+            wake_workers(walk, true);
+        }
+    }
+
+    return NULL;
+}
+
+MoveStats organize_tree(const char *directory, bool ask_misc, int max_depth, int worker_count) {
+    MoveStats totals = {0};
+
+    TreeWalk walk;
+    walk.root = directory;
+    walk.ask_misc = ask_misc;
+    walk.misc_answer = -1;
+    walk.max_depth = max_depth;
+    walk.worker_count = worker_count;
+    atomic_init(&walk.pending, 0);
+    atomic_init(&walk.generation, 0);
+    pthread_mutex_init(&walk.idle_lock, NULL);
+    pthread_cond_init(&walk.work_available, NULL);
+    pthread_mutex_init(&walk.misc_lock, NULL);
+
+    walk.root_fd = open(directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (walk.root_fd == -1) {
+        fprintf(stderr, "Unable to open directory: %s\n", directory);
+        pthread_cond_destroy(&walk.work_available);
+        pthread_mutex_destroy(&walk.idle_lock);
+        pthread_mutex_destroy(&walk.misc_lock);
+        return totals;
+    }
+
+    walk.workers = calloc(worker_count, sizeof(WalkWorker));
+    if (walk.workers == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+
+    for (int i = 0; i < worker_count; i++) {
+        walk.workers[i].walk = &walk;
+        walk.workers[i].id = i;
+        deque_init(&walk.workers[i].deque);
+    }
+
+    // "misc" has to be interned before any worker starts reading the table
+    if (ask_misc) {
+        intern_category("misc");
+    }
+
+    push_directory(&walk.workers[0], "", "", 0);
+
+    // Worker 0 runs on this thread, so a failed pthread_create only costs
+    // parallelism, never progress
+    int started = 1;
+    for (int i = 1; i < worker_count; i++) {
+        if (pthread_create(&walk.workers[i].thread, NULL, walk_worker_main, &walk.workers[i]) != 0) {
+            fprintf(stderr, "Failed to start worker thread %d\n", i);
+            break;
+        }
+        started++;
+    }
+
+    walk_worker_main(&walk.workers[0]);
+
+    for (int i = 1; i < started; i++) {
+        pthread_join(walk.workers[i].thread, NULL);
+    }
+
+    for (int i = 0; i < worker_count; i++) {
+        totals.moved += walk.workers[i].stats.moved;
+        totals.skipped += walk.workers[i].stats.skipped;
+        totals.failed += walk.workers[i].stats.failed;
+        free_file_batch(&walk.workers[i].batch);
+        deque_destroy(&walk.workers[i].deque);
+    }
+
+    free(walk.workers);
+    pthread_cond_destroy(&walk.work_available);
+    pthread_mutex_destroy(&walk.idle_lock);
+    pthread_mutex_destroy(&walk.misc_lock);
+    close(walk.root_fd);
+    return totals;
+}
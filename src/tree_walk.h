@@ -0,0 +1,39 @@
+/* =============================================================================
+   Program Name: FancyD (Fancy Directory Organizer)
+   Author: Nicholas D. Redmond (3A3YN1CKY)
+   Date: 8/13/2024
+   Description: Simple program to organize files in a directory.
+   ============================================================================= */
+
+#ifndef TREE_WALK_H
+#define TREE_WALK_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <fancy.h>
+
+typedef struct {
+    char *path;     // Relative to the root, "" for the root itself
+    int depth;
+} WalkTask;
+
+// Per-worker double-ended queue. The owner pushes and pops at the bottom
+// (depth-first, cache friendly); idle workers steal from the top, which
+// hands them the shallowest and usually largest remaining subtrees.
+typedef struct {
+    WalkTask *tasks;
+    size_t capacity;
+    size_t top;
+    size_t bottom;
+    pthread_mutex_t lock;
+} WalkDeque;
+
+// Sorts every directory under `directory` in place: files in each
+// directory go into category folders inside that same directory.
+// Category folders are never descended into, and directories deeper than
+// max_depth (root is 0, -1 for no limit) are left alone. With ask_misc,
+// the first directory holding uncategorized files prompts once for
+// whether they go in a 'misc' folder; the answer applies to the whole tree.
+MoveStats organize_tree(const char *directory, bool ask_misc, int max_depth, int worker_count);
+
+#endif // TREE_WALK_H
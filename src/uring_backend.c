@@ -0,0 +1,318 @@
+/* =============================================================================
+   Program Name: FancyD (Fancy Directory Organizer)
+   Author: Nicholas D. Redmond (3A3YN1CKY)
+   Date: 8/13/2024
+   Description: Simple program to organize files in a directory.
+   ============================================================================= */
+
+#include <uring_backend.h>
+#include <category_cache.h>
+#include <move_journal.h>
+#include <collision.h>
+
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+
+bool uring_available() {
+    return true;
+}
+
+// Settles a rename whose completion never arrived: the file is either
+// still in place, so it goes through the synchronous path, or the kernel
+// already moved it and only the bookkeeping is left
+static void recover_rename(int dir_fd, const char *directory, const char *name, CategoryDir *dir, MoveStats *stats) {
+    struct stat st;
+    if (fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+        move_into_category(dir_fd, directory, name, dir, stats);
+    } else if (fstatat(dir->fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+        journal_move(directory, name, dir->category, name);
+        stats->moved++;
+    } else {
+        fprintf(stderr, "Lost track of %s/%s while moving it to %s\n", directory, name, dir->category);
+        stats->failed++;
+    }
+}
+
+// Waits for `pending` completions and records them. Renames the kernel
+// doesn't understand (pre-5.11) come back as -EINVAL, categories on
+// another mount give -EXDEV, and a name already taken in the category
+// gives -EEXIST; all of them are redone through move_into_category, which
+// applies the collision policy, so the run still completes. If the ring
+// itself fails, the slots still outstanding are settled one by one and
+// -1 is returned; every slot is counted exactly once either way.
+static int reap_renames(struct io_uring *ring, unsigned pending, const char *directory, int dir_fd,
+                        const FileBatch *batch, CategoryDir *const *slot_dirs, const size_t *slot_entries,
+                        MoveStats *stats) {
+    bool reaped[URING_BATCH_SIZE] = {false};
+    unsigned outstanding = pending;
+
+    int submitted = io_uring_submit(ring);
+    if (submitted < 0) {
+        fprintf(stderr, "io_uring submit failed: %s\n", strerror(-submitted));
+    }
+
+    while (submitted >= 0 && outstanding > 0) {
+        struct io_uring_cqe *cqe;
+        int ret = io_uring_wait_cqe(ring, &cqe);
+        if (ret == -EINTR) continue;
+        if (ret < 0) {
+            fprintf(stderr, "io_uring wait failed: %s\n", strerror(-ret));
+            break;
+        }
+
+        size_t slot = (size_t)cqe->user_data;
+        int res = cqe->res;
+        io_uring_cqe_seen(ring, cqe);
+        reaped[slot] = true;
+        outstanding--;
+
+        const char *name = batch->names + batch->entries[slot_entries[slot]].name_offset;
+        CategoryDir *dir = slot_dirs[slot];
+
+        if (res == -EINVAL || res == -EOPNOTSUPP || res == -EXDEV || res == -EEXIST) {
+            move_into_category(dir_fd, directory, name, dir, stats);
+        } else if (res < 0) {
+            fprintf(stderr, "Failed to move %s/%s to %s/%s: %s\n",
+                    directory, name, directory, dir->category, strerror(-res));
+            stats->failed++;
+        } else {
+            journal_move(directory, name, dir->category, name);
+            if (verbose) {
+                printf("Moved %s to %s\n", name, dir->category);
+            }
+            stats->moved++;
+        }
+    }
+
+    if (outstanding == 0) return 0;
+
+    for (unsigned slot = 0; slot < pending; slot++) {
+        if (reaped[slot]) continue;
+        const char *name = batch->names + batch->entries[slot_entries[slot]].name_offset;
+        recover_rename(dir_fd, directory, name, slot_dirs[slot], stats);
+    }
+    return -1;
+}
+
+static int make_category_directories(struct io_uring *ring, int dir_fd, const char *directory,
+                                     const FileBatch *batch, const char *misc_category) {
+    // Interned category pointers make this a short pointer-compare scan
+    const char **seen = NULL;
+    size_t seen_count = 0;
+    size_t seen_capacity = 0;
+
+    for (size_t i = 0; i < batch->count; i++) {
+        const char *category = batch->entries[i].category ? batch->entries[i].category : misc_category;
+        if (category == NULL) continue;
+
+        size_t j;
+        for (j = 0; j < seen_count && seen[j] != category; j++);
+        if (j < seen_count) continue;
+
+        if (seen_count == seen_capacity) {
+            seen_capacity = seen_capacity ? seen_capacity * 2 : 16;
+            const char **grown = realloc(seen, sizeof(char *) * seen_capacity);
+            if (grown == NULL) {
+                fprintf(stderr, "Memory allocation failed\n");
+                free(seen);
+                return -1;
+            }
+            seen = grown;
+        }
+        seen[seen_count++] = category;
+    }
+
+    int result = 0;
+    for (size_t start = 0; start < seen_count; start += URING_BATCH_SIZE) {
+        size_t end = start + URING_BATCH_SIZE < seen_count ? start + URING_BATCH_SIZE : seen_count;
+
+        for (size_t i = start; i < end; i++) {
+            struct io_uring_sqe *sqe = io_uring_get_sqe(ring);
+            io_uring_prep_mkdirat(sqe, dir_fd, seen[i], 0777);
+            sqe->user_data = i;
+        }
+        io_uring_submit(ring);
+
+        for (size_t i = start; i < end; i++) {
+            struct io_uring_cqe *cqe;
+            if (io_uring_wait_cqe(ring, &cqe) < 0) {
+                result = -1;
+                break;
+            }
+            int res = cqe->res;
+            const char *category = seen[cqe->user_data];
+            io_uring_cqe_seen(ring, cqe);
+
+            if (res == -EINVAL || res == -EOPNOTSUPP) {
+                // Kernel predates IORING_OP_MKDIRAT
+                res = mkdirat(dir_fd, category, 0777) == 0 ? 0 : -errno;
+            }
+            if (res == 0) {
+                journal_category_created(directory, category);
+            } else if (res != -EEXIST) {
+                fprintf(stderr, "Failed to create category directory: %s\n", category);
+                result = -1;
+            }
+        }
+    }
+
+    free(seen);
+    return result;
+}
+
+int uring_move_batch(int dir_fd, const char *directory, const FileBatch *batch, bool handle_misc, MoveStats *stats) {
+    struct io_uring ring;
+    int ret = io_uring_queue_init(URING_QUEUE_DEPTH, &ring, 0);
+    if (ret < 0) {
+        if (verbose) {
+            printf("io_uring unavailable (%s), using synchronous moves\n", strerror(-ret));
+        }
+        return -1;
+    }
+
+    CategoryCache cache;
+    category_cache_init(&cache, dir_fd, directory);
+
+    const char *misc_category = handle_misc ? intern_category("misc") : NULL;
+
+    if (make_category_directories(&ring, dir_fd, directory, batch, misc_category) != 0) {
+        category_cache_destroy(&cache);
+        io_uring_queue_exit(&ring);
+        return -1;
+    }
+
+    CategoryDir *slot_dirs[URING_BATCH_SIZE];
+    size_t slot_entries[URING_BATCH_SIZE];
+    unsigned pending = 0;
+    bool ring_failed = false;
+    for (size_t i = 0; i < batch->count; i++) {
+        const char *name = batch->names + batch->entries[i].name_offset;
+        const char *category = batch->entries[i].category ? batch->entries[i].category : misc_category;
+
+        if (category == NULL) {
+            if (verbose) {
+                printf("Skipping uncategorized file: %s\n", name);
+            }
+            stats->skipped++;
+            continue;
+        }
+
+        CategoryDir *dir = category_cache_get(&cache, category);
+        if (dir->fd == -1) {
+            stats->failed++;
+            continue;
+        }
+
+        // Once the ring has failed, the rest of the batch goes the synchronous way
+        if (ring_failed) {
+            move_into_category(dir_fd, directory, name, dir, stats);
+            continue;
+        }
+
+        struct io_uring_sqe *sqe = io_uring_get_sqe(&ring);
+        // Never replace: a taken name comes back as -EEXIST and goes through the collision policy
+        io_uring_prep_renameat(sqe, dir_fd, name, dir->fd, name, RENAME_NOREPLACE);
+        sqe->user_data = pending;
+        slot_dirs[pending] = dir;
+        slot_entries[pending] = i;
+        pending++;
+
+        if (pending == URING_BATCH_SIZE) {
+            ring_failed = reap_renames(&ring, pending, directory, dir_fd, batch, slot_dirs, slot_entries, stats) != 0;
+            pending = 0;
+        }
+    }
+
+    if (pending > 0) {
+        reap_renames(&ring, pending, directory, dir_fd, batch, slot_dirs, slot_entries, stats);
+    }
+
+    category_cache_destroy(&cache);
+    io_uring_queue_exit(&ring);
+    return 0;
+}
+
+int uring_rename_batch(UringRename *renames, size_t count) {
+    struct io_uring ring;
+    int ret = io_uring_queue_init(URING_QUEUE_DEPTH, &ring, 0);
+    if (ret < 0) {
+        if (verbose) {
+            printf("io_uring unavailable (%s), using synchronous renames\n", strerror(-ret));
+        }
+        return -1;
+    }
+
+    for (size_t i = 0; i < count; i++) renames[i].result = -ECANCELED;
+
+    bool ring_failed = false;
+    for (size_t start = 0; start < count && !ring_failed; start += URING_BATCH_SIZE) {
+        size_t end = start + URING_BATCH_SIZE < count ? start + URING_BATCH_SIZE : count;
+        bool reaped[URING_BATCH_SIZE] = {false};
+
+        for (size_t i = start; i < end; i++) {
+            struct io_uring_sqe *sqe = io_uring_get_sqe(&ring);
+            io_uring_prep_renameat(sqe, renames[i].src_dir_fd, renames[i].src_name,
+                                   renames[i].dest_dir_fd, renames[i].dest_name, RENAME_NOREPLACE);
+            sqe->user_data = i;
+        }
+
+        int submitted = io_uring_submit(&ring);
+        if (submitted < 0) {
+            fprintf(stderr, "io_uring submit failed: %s\n", strerror(-submitted));
+            ring_failed = true;
+        }
+
+        for (size_t outstanding = end - start; !ring_failed && outstanding > 0; ) {
+            struct io_uring_cqe *cqe;
+            ret = io_uring_wait_cqe(&ring, &cqe);
+            if (ret == -EINTR) continue;
+            if (ret < 0) {
+                fprintf(stderr, "io_uring wait failed: %s\n", strerror(-ret));
+                ring_failed = true;
+                break;
+            }
+            size_t i = (size_t)cqe->user_data;
+            renames[i].result = cqe->res;
+            reaped[i - start] = true;
+            io_uring_cqe_seen(&ring, cqe);
+            outstanding--;
+        }
+
+        // A rename whose completion was lost either never happened, and
+        // stays -ECANCELED for the caller to redo, or already did
+        for (size_t i = start; ring_failed && i < end; i++) {
+            struct stat st;
+            if (reaped[i - start] || fstatat(renames[i].src_dir_fd, renames[i].src_name, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+                continue;
+            }
+            renames[i].result = fstatat(renames[i].dest_dir_fd, renames[i].dest_name, &st, AT_SYMLINK_NOFOLLOW) == 0
+                                    ? 0 : -ENOENT;
+        }
+    }
+
+    io_uring_queue_exit(&ring);
+    return 0;
+}
+
+#else
+
+bool uring_available() {
+    return false;
+}
+
+int uring_rename_batch(UringRename *renames, size_t count) {
+    (void)renames;
+    (void)count;
+    return -1;
+}
+
+int uring_move_batch(int dir_fd, const char *directory, const FileBatch *batch, bool handle_misc, MoveStats *stats) {
+    (void)dir_fd;
+    (void)directory;
+    (void)batch;
+    (void)handle_misc;
+    (void)stats;
+    return -1;
+}
+
+#endif
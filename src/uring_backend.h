@@ -0,0 +1,40 @@
+/* =============================================================================
+   Program Name: FancyD (Fancy Directory Organizer)
+   Author: Nicholas D. Redmond (3A3YN1CKY)
+   Date: 8/13/2024
+   Description: Simple program to organize files in a directory.
+   ============================================================================= */
+
+#ifndef URING_BACKEND_H
+#define URING_BACKEND_H
+
+#include <fancy.h>
+
+#define URING_QUEUE_DEPTH 512
+#define URING_BATCH_SIZE 256
+
+// Moves a scanned batch with io_uring, submitting MKDIRAT for each category
+// once and RENAMEAT for the files in groups of URING_BATCH_SIZE. Returns -1
+// without touching anything if io_uring isn't compiled in or the kernel
+// can't do it, so the caller can fall back to the synchronous path. If the
+// ring fails partway, the rest of the batch is finished synchronously here
+// and 0 is returned, since every file has then been accounted for.
+int uring_move_batch(int dir_fd, const char *directory, const FileBatch *batch, bool handle_misc, MoveStats *stats);
+bool uring_available();
+
+typedef struct {
+    int src_dir_fd;
+    const char *src_name;
+    int dest_dir_fd;
+    const char *dest_name;
+    int result;         // 0 or -errno once uring_rename_batch has run
+} UringRename;
+
+// Runs every rename with RENAME_NOREPLACE, URING_BATCH_SIZE per submit.
+// Completions arrive in any order, so no two entries may share a
+// destination. An entry the ring lost track of comes back as -ECANCELED
+// if its source is still there. Returns -1 without touching anything if
+// io_uring isn't compiled in or the kernel can't do it.
+int uring_rename_batch(UringRename *renames, size_t count);
+
+#endif // URING_BACKEND_H
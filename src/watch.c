@@ -0,0 +1,235 @@
+/* =============================================================================
+   Program Name: FancyD (Fancy Directory Organizer)
+   Author: Nicholas D. Redmond (3A3YN1CKY)
+   Date: 8/13/2024
+   Description: Simple program to organize files in a directory.
+   ============================================================================= */
+
+#include <watch.h>
+#include <poll.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void request_stop(int signal) {
+    (void)signal;
+    stop_requested = 1;
+}
+
+typedef struct {
+    char **names;
+    size_t count;
+    size_t capacity;
+    bool rescan;            // the event queue overflowed, so names are incomplete
+    bool reload;            // a config file changed
+    long first_event_ms;
+    long last_event_ms;
+} PendingEvents;
+
+static long now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+static bool has_pending(const PendingEvents *pending) {
+    return pending->count > 0 || pending->rescan || pending->reload;
+}
+
+// Flush once the burst has gone quiet, or once it has been running too long
+static long pending_deadline(const PendingEvents *pending) {
+    long quiet_deadline = pending->last_event_ms + WATCH_DEBOUNCE_MS;
+    long hard_deadline = pending->first_event_ms + WATCH_MAX_DELAY_MS;
+    return quiet_deadline < hard_deadline ? quiet_deadline : hard_deadline;
+}
+
+static void note_event(PendingEvents *pending) {
+    long now = now_ms();
+    if (!has_pending(pending)) pending->first_event_ms = now;
+    pending->last_event_ms = now;
+}
+
+static void add_pending_name(PendingEvents *pending, const char *name) {
+    if (pending->count == pending->capacity) {
+        size_t capacity = pending->capacity ? pending->capacity * 2 : 64;
+        char **names = realloc(pending->names, sizeof(char *) * capacity);
+        if (names == NULL) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        pending->names = names;
+        pending->capacity = capacity;
+    }
+
+    char *copy = strdup(name);
+    if (copy == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    pending->names[pending->count++] = copy;
+}
+
+static void flush_pending(PendingEvents *pending, int dir_fd, const char *directory, const char *config_folder) {
+    if (pending->reload) {
+        if (verbose) printf("Configuration changed, reloading rules\n");
+        load_configs(config_folder);
+    }
+
+    if (pending->rescan) {
+        // Events were lost; one full pass picks up whatever they were for
+        process_directory(directory, false);
+    } else {
+        for (size_t i = 0; i < pending->count; i++) {
+            // A name can show up more than once in a burst; after the
+            // first move it is simply no longer there
+            struct stat st;
+            if (fstatat(dir_fd, pending->names[i], &st, AT_SYMLINK_NOFOLLOW) != 0) {
+                if (errno != ENOENT) {
+                    fprintf(stderr, "Unable to get file stats for %s\n", pending->names[i]);
+                }
+                continue;
+            }
+            if (S_ISREG(st.st_mode)) {
+                process_file(dir_fd, directory, pending->names[i], false);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < pending->count; i++) free(pending->names[i]);
+    pending->count = 0;
+    pending->rescan = false;
+    pending->reload = false;
+}
+
+// Returns false when the watched directory itself went away
+static bool read_events(int inotify_fd, int dir_wd, int config_wd, PendingEvents *pending) {
+    char buffer[64 * 1024] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+    for (;;) {
+        ssize_t length = read(inotify_fd, buffer, sizeof(buffer));
+        if (length == -1) {
+            if (errno == EINTR) continue;
+            return true;    // EAGAIN: drained
+        }
+
+        for (char *p = buffer; p < buffer + length; ) {
+            const struct inotify_event *event = (const struct inotify_event *)p;
+            p += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                note_event(pending);
+                pending->rescan = true;
+                continue;
+            }
+            if (event->wd == dir_wd && (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED))) {
+                return false;
+            }
+            if (event->len == 0 || (event->mask & IN_ISDIR)) continue;
+
+            if (event->wd == dir_wd) {
+                note_event(pending);
+                add_pending_name(pending, event->name);
+            } else if (event->wd == config_wd && is_config_file(event->name)) {
+                note_event(pending);
+                pending->reload = true;
+            }
+        }
+    }
+}
+
+int watch_directory(const char *directory, const char *config_folder) {
+    int dir_fd = open(directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd == -1) {
+        fprintf(stderr, "Unable to open directory: %s\n", directory);
+        return -1;
+    }
+
+    int inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd == -1) {
+        fprintf(stderr, "Unable to start inotify: %s\n", strerror(errno));
+        close(dir_fd);
+        return -1;
+    }
+
+    // Subscribe before the first pass so nothing arriving during it is missed
+    int dir_wd = inotify_add_watch(inotify_fd, directory,
+                                   IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+    if (dir_wd == -1) {
+        fprintf(stderr, "Unable to watch %s: %s\n", directory, strerror(errno));
+        close(inotify_fd);
+        close(dir_fd);
+        return -1;
+    }
+    int config_wd = inotify_add_watch(inotify_fd, config_folder, IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_ONLYDIR);
+    if (config_wd == -1 && verbose) {
+        printf("Not watching %s for config changes: %s\n", config_folder, strerror(errno));
+    }
+
+    struct sigaction action = {0};
+    action.sa_handler = request_stop;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    load_configs(config_folder);
+    process_directory(directory, false);
+    if (verbose) printf("Watching %s\n", directory);
+
+    PendingEvents pending = {0};
+    int result = 0;
+    struct pollfd poll_fd = {.fd = inotify_fd, .events = POLLIN};
+
+    while (!stop_requested) {
+        int timeout = -1;
+        if (has_pending(&pending)) {
+            long now = now_ms();
+            long deadline = pending_deadline(&pending);
+            timeout = deadline > now ? (int)(deadline - now) : 0;
+        }
+
+        int ready = poll(&poll_fd, 1, timeout);
+        if (ready == -1) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "Error waiting for events: %s\n", strerror(errno));
+            result = -1;
+            break;
+        }
+
+        if (ready > 0 && !read_events(inotify_fd, dir_wd, config_wd, &pending)) {
+            fprintf(stderr, "Watched directory %s went away\n", directory);
+            result = -1;
+            break;
+        }
+
+        // A steady trickle of events keeps poll from ever timing out, so
+        // check the deadline after every wakeup rather than only on timeout
+        if (has_pending(&pending) && now_ms() >= pending_deadline(&pending)) {
+            flush_pending(&pending, dir_fd, directory, config_folder);
+        }
+    }
+
+    // Don't drop files that finished arriving just before the signal
+    if (has_pending(&pending) && result == 0) {
+        flush_pending(&pending, dir_fd, directory, config_folder);
+    }
+
+    for (size_t i = 0; i < pending.count; i++) free(pending.names[i]);
+    free(pending.names);
+    close(inotify_fd);
+    close(dir_fd);
+    return result;
+}
+
+#else
+
+int watch_directory(const char *directory, const char *config_folder) {
+    (void)directory;
+    (void)config_folder;
+    fprintf(stderr, "--watch needs inotify, which this platform doesn't have\n");
+    return -1;
+}
+
+#endif
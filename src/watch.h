@@ -0,0 +1,24 @@
+/* =============================================================================
+   Program Name: FancyD (Fancy Directory Organizer)
+   Author: Nicholas D. Redmond (3A3YN1CKY)
+   Date: 8/13/2024
+   Description: Simple program to organize files in a directory.
+   ============================================================================= */
+
+#ifndef WATCH_H
+#define WATCH_H
+
+#include <fancy.h>
+
+// A burst of events is handled once it has been quiet this long, but never
+// later than WATCH_MAX_DELAY_MS after its first event
+#define WATCH_DEBOUNCE_MS 100
+#define WATCH_MAX_DELAY_MS 500
+
+// Sorts the directory once, then stays resident and sorts each file as it
+// is finished (IN_CLOSE_WRITE) or moved in (IN_MOVED_TO). Changes to the
+// config folder reload the rules. Runs until SIGINT/SIGTERM and returns 0,
+// or -1 if the directory can't be watched.
+int watch_directory(const char *directory, const char *config_folder);
+
+#endif // WATCH_H
@@ -0,0 +1,184 @@
+/* =============================================================================
+   Program Name: FancyD (Fancy Directory Organizer)
+   Author: Nicholas D. Redmond (3A3YN1CKY)
+   Date: 8/13/2024
+   Description: Simple program to organize files in a directory.
+   ============================================================================= */
+
+#include <xdev_move.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#ifdef __linux__
+#include <linux/fs.h>
+#endif
+
+int copy_file_data(int src_fd, int dest_fd, off_t size) {
+#ifdef FICLONE
+    // Reflink shares the extents outright on btrfs/XFS/bcachefs
+    if (ioctl(dest_fd, FICLONE, src_fd) == 0) {
+        // The clone takes the source as it is now, which may not be `size`
+        struct stat st;
+        if (fstat(dest_fd, &st) != 0) return -1;
+        if (st.st_size != size) {
+            errno = EIO;
+            return -1;
+        }
+        return 0;
+    }
+#endif
+
+    off_t copied = 0;
+    bool use_sendfile = false;
+
+    while (copied < size) {
+        ssize_t n;
+        if (!use_sendfile) {
+            n = copy_file_range(src_fd, NULL, dest_fd, NULL, size - copied, 0);
+            if (n == -1 && (errno == EXDEV || errno == ENOSYS || errno == EOPNOTSUPP || errno == EINVAL)) {
+                // Older kernels refuse cross-filesystem copy_file_range
+                use_sendfile = true;
+                continue;
+            }
+        } else {
+            n = sendfile(dest_fd, src_fd, NULL, size - copied);
+        }
+
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (n == 0) break; // Source shrank underneath us
+        copied += n;
+    }
+
+    // A short copy must never be published in place of the original
+    if (copied != size) {
+        errno = EIO;
+        return -1;
+    }
+    return 0;
+}
+
+// Renames the finished copy into place without replacing anything that
+// already has the name; fails with EEXIST instead
+static int publish_copy(int dir_fd, const char *temp_name, const char *dest_name) {
+#ifdef RENAME_NOREPLACE
+    if (renameat2(dir_fd, temp_name, dir_fd, dest_name, RENAME_NOREPLACE) == 0) return 0;
+    if (errno != EINVAL && errno != ENOSYS) return -1;
+#endif
+
+    // link() never replaces either, on filesystems that have hard links
+    if (linkat(dir_fd, temp_name, dir_fd, dest_name, 0) == 0) {
+        unlinkat(dir_fd, temp_name, 0);
+        return 0;
+    }
+    if (errno != EPERM && errno != EOPNOTSUPP && errno != ENOSYS) return -1;
+
+    struct stat st;
+    if (fstatat(dir_fd, dest_name, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+        errno = EEXIST;
+        return -1;
+    }
+    return renameat(dir_fd, temp_name, dir_fd, dest_name);
+}
+
+int move_across_devices(int src_dir_fd, const char *src_name, int dest_dir_fd, const char *dest_name) {
+    int src_fd = openat(src_dir_fd, src_name, O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+    if (src_fd == -1) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(src_fd, &st) != 0) {
+        int saved = errno;
+        close(src_fd);
+        errno = saved;
+        return -1;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        close(src_fd);
+        errno = EINVAL;
+        return -1;
+    }
+
+    // Copy into a private name first so a half-written file never shows
+    // up under the real name, even if we crash mid-copy
+    static unsigned long counter = 0;
+    char temp_name[64];
+    int dest_fd = -1;
+    for (int attempt = 0; attempt < 100 && dest_fd == -1; attempt++) {
+        snprintf(temp_name, sizeof(temp_name), ".fancyD-%ld-%lu.tmp", (long)getpid(),
+                 __atomic_fetch_add(&counter, 1, __ATOMIC_RELAXED));
+        dest_fd = openat(dest_dir_fd, temp_name, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+        if (dest_fd == -1 && errno != EEXIST) break;
+    }
+    if (dest_fd == -1) {
+        int saved = errno;
+        close(src_fd);
+        errno = saved;
+        return -1;
+    }
+
+    int result = copy_file_data(src_fd, dest_fd, st.st_size);
+
+    // Something writing to the source mid-copy leaves it a different size
+    // or mtime; the copy would be a torn snapshot, so give up on this file
+    struct stat after;
+    if (result == 0) {
+        if (fstat(src_fd, &after) != 0) {
+            result = -1;
+        } else if (after.st_size != st.st_size || after.st_mtim.tv_sec != st.st_mtim.tv_sec ||
+                   after.st_mtim.tv_nsec != st.st_mtim.tv_nsec) {
+            errno = EIO;
+            result = -1;
+        }
+    }
+
+    if (result == 0) {
+        // Ownership only sticks for root; the rest must succeed
+        if (fchown(dest_fd, st.st_uid, st.st_gid) != 0 && verbose) {
+            printf("Could not preserve ownership of %s\n", src_name);
+        }
+        struct timespec times[2] = { st.st_atim, st.st_mtim };
+        if (fchmod(dest_fd, st.st_mode & 07777) != 0 || futimens(dest_fd, times) != 0 || fsync(dest_fd) != 0) {
+            result = -1;
+        }
+    }
+
+    int saved = errno;
+    if (close(dest_fd) != 0 && result == 0) {
+        saved = errno;
+        result = -1;
+    }
+    close(src_fd);
+
+    if (result == 0 && publish_copy(dest_dir_fd, temp_name, dest_name) != 0) {
+        saved = errno;
+        result = -1;
+    }
+
+    if (result != 0) {
+        // Whatever went wrong, including EEXIST, the source stays put
+        unlinkat(dest_dir_fd, temp_name, 0);
+        errno = saved;
+        return -1;
+    }
+
+    // The rename itself has to reach the disk before the source goes,
+    // or a crash right here could leave neither name pointing at the data
+    int sync_fd = openat(dest_dir_fd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (sync_fd == -1 || fsync(sync_fd) != 0) {
+        saved = errno;
+        if (sync_fd != -1) close(sync_fd);
+        fprintf(stderr, "Copied %s but could not sync its new directory, keeping the original\n", src_name);
+        errno = saved;
+        return -1;
+    }
+    close(sync_fd);
+
+    // The copy is durable under its final name; now the source can go
+    if (unlinkat(src_dir_fd, src_name, 0) != 0) {
+        fprintf(stderr, "Copied %s but could not remove the original: %s\n", src_name, strerror(errno));
+    }
+    return 0;
+}
@@ -0,0 +1,27 @@
+/* =============================================================================
+   Program Name: FancyD (Fancy Directory Organizer)
+   Author: Nicholas D. Redmond (3A3YN1CKY)
+   Date: 8/13/2024
+   Description: Simple program to organize files in a directory.
+   ============================================================================= */
+
+#ifndef XDEV_MOVE_H
+#define XDEV_MOVE_H
+
+#include <fancy.h>
+
+// Moves a file between directories on different filesystems, where rename
+// fails with EXDEV. The data is reflinked when the filesystems allow it
+// and otherwise copied in-kernel (copy_file_range, then sendfile) into a
+// temporary name next to the destination. Mode, ownership and timestamps
+// are carried over, the copy is fsync'd and renamed into place, and only
+// then is the source unlinked. An existing dest_name is never replaced:
+// the copy is dropped and errno is EEXIST. Returns 0 on success, -1 with
+// errno set.
+int move_across_devices(int src_dir_fd, const char *src_name, int dest_dir_fd, const char *dest_name);
+
+// Copies exactly `size` bytes; fails with EIO if the source turns out to
+// be shorter, so a truncated copy is never mistaken for a finished one
+int copy_file_data(int src_fd, int dest_fd, off_t size);
+
+#endif // XDEV_MOVE_H
@@ -10,11 +10,25 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 #include <unistd.h>
 #include <string.h>
 #include <stdbool.h>
 #include "../src/fancy.h"
 #include "../src/utils.h"
+#include "../src/xdev_move.h"
+#include "../src/tree_walk.h"
+#include "../src/rule_cache.h"
+#include "../src/config_batch.h"
+#include "../src/config_writer.h"
+#include "../src/glob_rules.h"
+#include "../src/sniff.h"
+#include "../src/watch.h"
+#include "../src/scan_state.h"
+#include "../src/move_plan.h"
+#include "../src/move_journal.h"
+#include "../src/collision.h"
+#include <signal.h>
 
 // Helper function to create a temporary directory
 char* create_temp_dir() {
@@ -124,6 +138,25 @@ START_TEST(test_add_duplicate_extension)
     }
     ck_assert_int_eq(found, 1);
 
+    // With a second config also listing .txt, moving it must not let the
+    // leftover duplicate stay in memory and end up in the rule cache
+    char *notes_path = safe_path_join(config_folder, "Notes_config.json");
+    FILE *notes = fopen(notes_path, "w");
+    fputs("{\".txt\": \"Notes\"}", notes);
+    fclose(notes);
+    free(notes_path);
+
+    input = fmemopen("y\n", 2, "r");
+    stdin = input;
+    add_extension(config_folder, ".txt", "Text");
+    stdin = old_stdin;
+    fclose(input);
+
+    ck_assert_str_eq(get_category_for_extension(".txt"), "Text");
+    load_configs(config_folder);
+    ck_assert(index_is_mapped);
+    ck_assert_str_eq(get_category_for_extension(".txt"), "Text");
+
     // Clean up
     delete_config_files(config_folder);
     rmdir(config_folder);
@@ -535,6 +568,1150 @@ START_TEST(test_organize_files)
 }
 END_TEST
 
+// Test the extension index lookup
+START_TEST(test_extension_index_lookup)
+{
+    free_existing_mappings();
+    initialize_mappings();
+
+    // Enough mappings to force the index to grow a few times
+    char extension[32];
+    char category[32];
+    for (int i = 0; i < 900; i++) {
+        snprintf(extension, sizeof(extension), ".ext%d", i);
+        snprintf(category, sizeof(category), "Category%d", i % 7);
+        add_mapping(extension, category);
+    }
+    add_mapping(".ext5", "Duplicate");
+
+    ck_assert_str_eq(get_category_for_extension(".ext0"), "Category0");
+    ck_assert_str_eq(get_category_for_extension("EXT899"), "Category3");
+    ck_assert_str_eq(get_category_for_extension(".Ext5"), "Category5");
+    ck_assert_ptr_null(get_category_for_extension(".ext900"));
+
+    free_existing_mappings();
+}
+END_TEST
+
+// Test removing mappings one at a time from the extension index
+START_TEST(test_remove_mapping)
+{
+    free_existing_mappings();
+    initialize_mappings();
+
+    char extension[32];
+    for (int i = 0; i < 600; i++) {
+        snprintf(extension, sizeof(extension), ".rm%d", i);
+        add_mapping(extension, i % 2 ? "Odd" : "Even");
+    }
+    add_mapping(".rm7", "Shadowed");
+
+    // Every other removal leaves holes all over the probe chains
+    for (int i = 0; i < 600; i += 2) {
+        snprintf(extension, sizeof(extension), ".RM%d", i);
+        ck_assert(remove_mapping(extension));
+    }
+    ck_assert(!remove_mapping(".rm0"));
+    ck_assert_int_eq(mapping_count, 301);
+
+    for (int i = 0; i < 600; i++) {
+        snprintf(extension, sizeof(extension), ".rm%d", i);
+        if (i % 2) {
+            ck_assert_str_eq(get_category_for_extension(extension), "Odd");
+        } else {
+            ck_assert_ptr_null(get_category_for_extension(extension));
+        }
+    }
+
+    // The second listing of an extension takes over once the first is gone
+    ck_assert(remove_mapping(".rm7"));
+    ck_assert_str_eq(get_category_for_extension(".rm7"), "Shadowed");
+    ck_assert(remove_mapping(".rm7"));
+    ck_assert_ptr_null(get_category_for_extension(".rm7"));
+
+    free_existing_mappings();
+}
+END_TEST
+
+// Test that --add keeps the rule cache in step with the config files
+START_TEST(test_add_extension_updates_cache)
+{
+    char *test_dir = create_temp_dir();
+    char config_folder[MAX_PATH];
+    snprintf(config_folder, sizeof(config_folder), "%s/.fancyD", test_dir);
+    ensure_config_folder(config_folder);
+
+    add_extension(config_folder, ".aaa", "First");
+    add_extension(config_folder, ".bbb", "First");
+
+    FILE *input = fmemopen("y\n", 2, "r");
+    FILE *old_stdin = stdin;
+    stdin = input;
+    add_extension(config_folder, ".aaa", "Second");
+    stdin = old_stdin;
+    fclose(input);
+
+    ck_assert_str_eq(get_category_for_extension(".aaa"), "Second");
+    ck_assert_str_eq(get_category_for_extension(".bbb"), "First");
+
+    // The cache written from memory must still match the files on disk
+    free_existing_mappings();
+    initialize_mappings();
+    ck_assert_int_eq(load_rule_cache(config_folder), 0);
+    ck_assert_int_eq(mapping_count, 2);
+    ck_assert_str_eq(get_category_for_extension(".aaa"), "Second");
+    ck_assert_str_eq(get_category_for_extension(".bbb"), "First");
+
+    free_existing_mappings();
+    delete_config_files(config_folder);
+    rmdir(test_dir);
+    free(test_dir);
+}
+END_TEST
+
+// Test bulk import with each conflict policy
+START_TEST(test_import_rules)
+{
+    char *test_dir = create_temp_dir();
+    char config_folder[MAX_PATH];
+    char import_path[MAX_PATH];
+    snprintf(config_folder, sizeof(config_folder), "%s/.fancyD", test_dir);
+    snprintf(import_path, sizeof(import_path), "%s/import.tsv", test_dir);
+    ensure_config_folder(config_folder);
+
+    add_extension(config_folder, ".png", "Images");
+
+    FILE *file = fopen(import_path, "w");
+    fputs("# provisioning list\n.png\tPhotos\n\ntxt\tDocuments\n.md  Documents\nreport-*.pdf\tReports\n", file);
+    fclose(file);
+    ck_assert_int_eq(import_rules(config_folder, import_path, CONFLICT_KEEP), 0);
+
+    load_configs(config_folder);
+    ck_assert_str_eq(get_category_for_extension(".png"), "Images");
+    ck_assert_str_eq(get_category_for_extension(".txt"), "Documents");
+    ck_assert_str_eq(get_category_for_extension(".md"), "Documents");
+    // Globs are imported as written rather than dot-prefixed
+    ck_assert_str_eq(get_category_for_filename("report-2024.pdf"), "Reports");
+
+    // A conflict under the abort policy leaves every file untouched
+    file = fopen(import_path, "w");
+    fputs("{\"Photos\": [\".gif\", \".png\"]}", file);
+    fclose(file);
+    ck_assert_int_eq(import_rules(config_folder, import_path, CONFLICT_ABORT), -1);
+    char *photos_path = safe_path_join(config_folder, "Photos_config.json");
+    char *images_path = safe_path_join(config_folder, "Images_config.json");
+    ck_assert_int_ne(access(photos_path, F_OK), 0);
+
+    ck_assert_int_eq(import_rules(config_folder, import_path, CONFLICT_REPLACE), 0);
+    ck_assert_int_eq(access(photos_path, F_OK), 0);
+    ck_assert_int_ne(access(images_path, F_OK), 0);
+    free(photos_path);
+    free(images_path);
+
+    load_configs(config_folder);
+    ck_assert_str_eq(get_category_for_extension(".png"), "Photos");
+    ck_assert_str_eq(get_category_for_extension(".gif"), "Photos");
+    ck_assert_int_eq(mapping_count, 5);
+
+    free_existing_mappings();
+    delete_config_files(config_folder);
+    remove(import_path);
+    rmdir(test_dir);
+    free(test_dir);
+}
+END_TEST
+
+// Test that --default merges without prompting and is safe to repeat
+START_TEST(test_create_default_configs_merge)
+{
+    char *test_dir = create_temp_dir();
+    char config_folder[MAX_PATH];
+    snprintf(config_folder, sizeof(config_folder), "%s/.fancyD", test_dir);
+    ensure_config_folder(config_folder);
+
+    ck_assert_int_eq(create_default_configs(config_folder), 0);
+    load_configs(config_folder);
+    int first_count = mapping_count;
+    ck_assert_int_gt(first_count, 0);
+    ck_assert_str_eq(get_category_for_extension(".jpg"), "Images");
+
+    // Nothing on stdin: a second merge must not need any answers
+    FILE *input = fmemopen("", 1, "r");
+    FILE *old_stdin = stdin;
+    stdin = input;
+    ck_assert_int_eq(create_default_configs(config_folder), 0);
+    stdin = old_stdin;
+    fclose(input);
+
+    load_configs(config_folder);
+    ck_assert_int_eq(mapping_count, first_count);
+
+    char *config_path = safe_path_join(config_folder, "Images_config.json");
+    cJSON *json;
+    ck_assert_int_eq(parse_json_file(config_path, &json), 0);
+    ck_assert_ptr_nonnull(json);
+    int jpg_entries = 0;
+    cJSON *item;
+    cJSON_ArrayForEach(item, json) {
+        if (strcmp(item->string, ".jpg") == 0) jpg_entries++;
+    }
+    ck_assert_int_eq(jpg_entries, 1);
+    cJSON_Delete(json);
+    free(config_path);
+
+    free_existing_mappings();
+    delete_config_files(config_folder);
+    rmdir(test_dir);
+    free(test_dir);
+}
+END_TEST
+
+// Test that concurrent runs don't lose each other's config updates
+START_TEST(test_concurrent_add_extension)
+{
+    char *test_dir = create_temp_dir();
+    char config_folder[MAX_PATH];
+    snprintf(config_folder, sizeof(config_folder), "%s/.fancyD", test_dir);
+    ensure_config_folder(config_folder);
+
+    const int writers = 4;
+    const int adds = 25;
+    for (int w = 0; w < writers; w++) {
+        pid_t pid = fork();
+        ck_assert_int_ne(pid, -1);
+        if (pid == 0) {
+            fclose(stdout);
+            char extension[32];
+            for (int i = 0; i < adds; i++) {
+                snprintf(extension, sizeof(extension), ".w%di%d", w, i);
+                add_extension(config_folder, extension, "Shared");
+            }
+            _exit(0);
+        }
+    }
+    for (int w = 0; w < writers; w++) {
+        int status;
+        wait(&status);
+        ck_assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+
+    load_configs(config_folder);
+    ck_assert_int_eq(mapping_count, writers * adds);
+
+    free_existing_mappings();
+    delete_config_files(config_folder);
+    rmdir(test_dir);
+    free(test_dir);
+}
+END_TEST
+
+// Test the streaming config serializer in both layouts
+START_TEST(test_write_config_json)
+{
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddStringToObject(json, ".png", "Images");
+    cJSON_AddStringToObject(json, ".q\"\\", "Tab\tName");
+
+    char output[256];
+    FILE *file = fmemopen(output, sizeof(output), "w");
+    ck_assert_int_eq(write_config_json(file, json, false), 0);
+    fclose(file);
+    ck_assert_str_eq(output, "{\n\t\".png\":\t\"Images\",\n\t\".q\\\"\\\\\":\t\"Tab\\tName\"\n}");
+
+    file = fmemopen(output, sizeof(output), "w");
+    ck_assert_int_eq(write_config_json(file, json, true), 0);
+    fclose(file);
+    ck_assert_str_eq(output, "{\".png\":\"Images\",\".q\\\"\\\\\":\"Tab\\tName\"}");
+
+    // Whatever is written must parse back to the same mappings
+    cJSON *parsed = cJSON_Parse(output);
+    ck_assert_ptr_nonnull(parsed);
+    ck_assert_str_eq(cJSON_GetObjectItemCaseSensitive(parsed, ".q\"\\")->valuestring, "Tab\tName");
+    cJSON_Delete(parsed);
+
+    cJSON *empty = cJSON_CreateObject();
+    file = fmemopen(output, sizeof(output), "w");
+    ck_assert_int_eq(write_config_json(file, empty, false), 0);
+    fclose(file);
+    ck_assert_str_eq(output, "{\n}");
+
+    cJSON_Delete(empty);
+    cJSON_Delete(json);
+}
+END_TEST
+
+// Test that compound extensions beat their last component
+START_TEST(test_compound_extension_match)
+{
+    free_existing_mappings();
+    initialize_mappings();
+
+    add_mapping(".gz", "Compressed");
+    add_mapping(".tar.gz", "Tarballs");
+    add_mapping(".TAR.ZST", "Tarballs");
+    add_mapping(".tar", "Archive");
+
+    ck_assert_str_eq(get_category_for_filename("backup.tar.gz"), "Tarballs");
+    ck_assert_str_eq(get_category_for_filename("Backup.TAR.GZ"), "Tarballs");
+    ck_assert_str_eq(get_category_for_filename("release-1.0.tar.zst"), "Tarballs");
+    ck_assert_str_eq(get_category_for_filename("notes.gz"), "Compressed");
+    ck_assert_str_eq(get_category_for_filename("star.gz"), "Compressed");
+    ck_assert_str_eq(get_category_for_filename("tar.gz"), "Compressed");
+    ck_assert_str_eq(get_category_for_filename("plain.tar"), "Archive");
+    ck_assert_ptr_null(get_category_for_filename("backup.zst"));
+    ck_assert_ptr_null(get_category_for_filename(".gz"));
+    ck_assert_ptr_null(get_category_for_filename("gz"));
+
+    // Removing the compound mapping falls back to the plain one
+    ck_assert(remove_mapping(".tar.gz"));
+    ck_assert_str_eq(get_category_for_filename("backup.tar.gz"), "Compressed");
+
+    free_existing_mappings();
+}
+END_TEST
+
+// Test wildcard, prefix and catch-all rules next to plain extensions
+START_TEST(test_glob_rules)
+{
+    free_existing_mappings();
+    initialize_mappings();
+
+    add_mapping(".jpg", "Images");
+    add_mapping("IMG_*.jpg", "Camera");
+    add_mapping("*_backup*", "Backups");
+    add_mapping("report-????.pdf", "Reports");
+    add_mapping("*", "misc");
+    refresh_filename_rules();
+
+    ck_assert_str_eq(get_category_for_filename("IMG_0001.JPG"), "Camera");
+    ck_assert_str_eq(get_category_for_filename("photo.jpg"), "Images");
+    ck_assert_str_eq(get_category_for_filename("db_backup_2024.sql"), "Backups");
+    ck_assert_str_eq(get_category_for_filename("IMG_backup.jpg"), "Camera");
+    ck_assert_str_eq(get_category_for_filename("report-2024.pdf"), "Reports");
+    ck_assert_str_eq(get_category_for_filename("report-24.pdf"), "misc");
+    ck_assert_str_eq(get_category_for_filename("random.xyz"), "misc");
+
+    ck_assert(remove_mapping("*"));
+    refresh_filename_rules();
+    ck_assert_ptr_null(get_category_for_filename("random.xyz"));
+    ck_assert(remove_mapping("IMG_*.jpg"));
+    refresh_filename_rules();
+    ck_assert_str_eq(get_category_for_filename("IMG_0001.JPG"), "Images");
+
+    free_existing_mappings();
+
+    // A pattern whose DFA would explode still matches, just rule by rule
+    GlobMatcher matcher;
+    glob_matcher_init(&matcher);
+    glob_matcher_add(&matcher, "*a????????????", "Tail");
+    glob_matcher_compile(&matcher);
+    ck_assert_int_eq(matcher.dfa_states, 0);
+    ck_assert_str_eq(glob_matcher_match(&matcher, "xxA123456789012"), "Tail");
+    ck_assert_ptr_null(glob_matcher_match(&matcher, "xxb123456789012"));
+    glob_matcher_destroy(&matcher);
+}
+END_TEST
+
+// Test magic-byte detection for files without an extension
+START_TEST(test_sniff_content)
+{
+    unsigned char buffer[SNIFF_BYTES] = {0};
+    memcpy(buffer, "\x89PNG\r\n\x1a\n", 8);
+    ck_assert_str_eq(sniff_buffer(buffer, sizeof(buffer)), ".png");
+    memcpy(buffer, "RIFF\0\0\0\0WAVE", 12);
+    ck_assert_str_eq(sniff_buffer(buffer, sizeof(buffer)), ".wav");
+    memcpy(buffer, "\0\0\0\x14" "ftypqt  ", 12);
+    ck_assert_str_eq(sniff_buffer(buffer, sizeof(buffer)), ".mov");
+    memcpy(buffer, "\0\0\0\x18" "ftypisom", 12);
+    ck_assert_str_eq(sniff_buffer(buffer, sizeof(buffer)), ".mp4");
+    memset(buffer, 0, sizeof(buffer));
+    memcpy(buffer + 257, "ustar", 5);
+    ck_assert_str_eq(sniff_buffer(buffer, sizeof(buffer)), ".tar");
+    ck_assert_ptr_null(sniff_buffer((const unsigned char *)"plain text", 10));
+    ck_assert_ptr_null(sniff_buffer((const unsigned char *)"\x89PN", 4));
+
+    char *test_dir = create_temp_dir();
+    free_existing_mappings();
+    initialize_mappings();
+    add_mapping(".pdf", "Documents");
+
+    char path[MAX_PATH];
+    snprintf(path, sizeof(path), "%s/statement", test_dir);
+    FILE *file = fopen(path, "w");
+    fputs("%PDF-1.7\n", file);
+    fclose(file);
+    snprintf(path, sizeof(path), "%s/notes", test_dir);
+    file = fopen(path, "w");
+    fputs("just text\n", file);
+    fclose(file);
+
+    sniff_content = true;
+    FileBatch batch;
+    ck_assert(scan_directory(test_dir, &batch));
+    sniff_content = false;
+
+    ck_assert_int_eq(batch.count, 2);
+    for (size_t i = 0; i < batch.count; i++) {
+        const char *name = batch.names + batch.entries[i].name_offset;
+        if (strcmp(name, "statement") == 0) {
+            ck_assert_str_eq(batch.entries[i].category, "Documents");
+        } else {
+            ck_assert_ptr_null(batch.entries[i].category);
+        }
+    }
+    free_file_batch(&batch);
+
+    remove(path);
+    snprintf(path, sizeof(path), "%s/statement", test_dir);
+    remove(path);
+    rmdir(test_dir);
+    free(test_dir);
+    free_existing_mappings();
+}
+END_TEST
+
+static bool wait_for_path(const char *path) {
+    for (int i = 0; i < 200; i++) {
+        if (access(path, F_OK) == 0) return true;
+        usleep(10000);
+    }
+    return false;
+}
+
+static void touch_file(const char *folder, const char *name) {
+    char *path = safe_path_join(folder, name);
+    FILE *file = fopen(path, "w");
+    fputs("data", file);
+    fclose(file);
+    free(path);
+}
+
+// Test that watch mode sorts existing files, then new arrivals and new rules
+START_TEST(test_watch_directory)
+{
+    char *test_dir = create_temp_dir();
+    char *inbox = safe_path_join(test_dir, "inbox");
+    char *config_folder = safe_path_join(test_dir, ".fancyD");
+    mkdir(inbox, 0755);
+    ensure_config_folder(config_folder);
+    char *images_config = safe_path_join(config_folder, "Images_config.json");
+    FILE *config = fopen(images_config, "w");
+    fputs("{\".png\": \"Images\"}", config);
+    fclose(config);
+    free(images_config);
+    touch_file(inbox, "old.png");
+
+    pid_t pid = fork();
+    ck_assert_int_ne(pid, -1);
+    if (pid == 0) {
+        fclose(stdout);
+        _exit(watch_directory(inbox, config_folder) == 0 ? 0 : 1);
+    }
+
+    char path[MAX_PATH];
+    snprintf(path, sizeof(path), "%s/Images/old.png", inbox);
+    ck_assert(wait_for_path(path));
+
+    touch_file(inbox, "new.png");
+    snprintf(path, sizeof(path), "%s/Images/new.png", inbox);
+    ck_assert(wait_for_path(path));
+
+    // A config written while running applies without a restart
+    char *notes_config = safe_path_join(config_folder, "Notes_config.json");
+    config = fopen(notes_config, "w");
+    fputs("{\".txt\": \"Notes\"}", config);
+    fclose(config);
+    usleep(2 * WATCH_MAX_DELAY_MS * 1000);
+    touch_file(inbox, "todo.txt");
+    snprintf(path, sizeof(path), "%s/Notes/todo.txt", inbox);
+    ck_assert(wait_for_path(path));
+
+    kill(pid, SIGTERM);
+    int status;
+    waitpid(pid, &status, 0);
+    ck_assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    remove(path);
+    snprintf(path, sizeof(path), "%s/Notes", inbox);
+    rmdir(path);
+    snprintf(path, sizeof(path), "%s/Images/old.png", inbox);
+    remove(path);
+    snprintf(path, sizeof(path), "%s/Images/new.png", inbox);
+    remove(path);
+    snprintf(path, sizeof(path), "%s/Images", inbox);
+    rmdir(path);
+    rmdir(inbox);
+    delete_config_files(config_folder);
+    rmdir(test_dir);
+    free(notes_config);
+    free(config_folder);
+    free(inbox);
+    free(test_dir);
+}
+END_TEST
+
+// Test that the scan state skips known files and notices changes
+START_TEST(test_scan_state)
+{
+    char *test_dir = create_temp_dir();
+    char *config_folder = safe_path_join(test_dir, ".fancyD");
+    ensure_config_folder(config_folder);
+    char *inbox = safe_path_join(test_dir, "inbox");
+    mkdir(inbox, 0755);
+    touch_file(inbox, "a.txt");
+    touch_file(inbox, "keep.bin");
+
+    free_existing_mappings();
+    initialize_mappings();
+    add_mapping(".txt", "Documents");
+
+    // First run: nothing recorded yet, so every file is looked at
+    int dir_fd = open(inbox, O_RDONLY | O_DIRECTORY);
+    ScanState state;
+    ck_assert_int_eq(scan_state_open(&state, config_folder, dir_fd), 0);
+    ck_assert(!scan_state_unchanged(&state));
+    FileBatch batch;
+    ck_assert(scan_directory_incremental(dir_fd, inbox, &batch, &state));
+    ck_assert_int_eq(batch.count, 2);
+    for (size_t i = 0; i < batch.count; i++) {
+        if (batch.entries[i].category == NULL) {
+            scan_state_keep(&state, dir_fd, batch.names + batch.entries[i].name_offset);
+        }
+    }
+    free_file_batch(&batch);
+
+    // Pretend the directory was last touched long ago
+    struct timespec times[2] = { { 1000000000, 0 }, { 1000000000, 0 } };
+    futimens(dir_fd, times);
+    ck_assert_int_eq(scan_state_save(&state, dir_fd, false), 0);
+    scan_state_close(&state);
+
+    ck_assert_int_eq(scan_state_open(&state, config_folder, dir_fd), 0);
+    ck_assert(scan_state_unchanged(&state));
+    ck_assert(scan_state_skipped_before(&state, dir_fd, "keep.bin"));
+    ck_assert(!scan_state_skipped_before(&state, dir_fd, "a.txt"));
+    scan_state_close(&state);
+
+    // A new arrival changes the mtime; the known file is still offered as
+    // uncategorized so misc can take it this time
+    touch_file(inbox, "b.txt");
+    ck_assert_int_eq(scan_state_open(&state, config_folder, dir_fd), 0);
+    ck_assert(!scan_state_unchanged(&state));
+    lseek(dir_fd, 0, SEEK_SET);     // the first scan left the fd at the end
+    ck_assert(scan_directory_incremental(dir_fd, inbox, &batch, &state));
+    ck_assert_int_eq(batch.count, 3);
+    ck_assert(batch.has_uncategorized);
+    for (size_t i = 0; i < batch.count; i++) {
+        if (batch.entries[i].category == NULL) {
+            ck_assert_str_eq(batch.names + batch.entries[i].name_offset, "keep.bin");
+            scan_state_keep(&state, dir_fd, "keep.bin");
+        }
+    }
+    free_file_batch(&batch);
+    ck_assert_int_eq(scan_state_save(&state, dir_fd, true), 0);
+    scan_state_close(&state);
+
+    // Moves happened, so the next run may not short-circuit
+    ck_assert_int_eq(scan_state_open(&state, config_folder, dir_fd), 0);
+    ck_assert(!scan_state_unchanged(&state));
+    ck_assert(scan_state_skipped_before(&state, dir_fd, "keep.bin"));
+    scan_state_close(&state);
+
+    // Rewriting the file under the same name means it has to be looked at again
+    char path[MAX_PATH];
+    snprintf(path, sizeof(path), "%s/keep.bin", inbox);
+    FILE *file = fopen(path, "w");
+    ck_assert_ptr_nonnull(file);
+    fputs("new contents", file);
+    fclose(file);
+    ck_assert_int_eq(scan_state_open(&state, config_folder, dir_fd), 0);
+    ck_assert(!scan_state_skipped_before(&state, dir_fd, "keep.bin"));
+    scan_state_keep(&state, dir_fd, "keep.bin");
+    ck_assert_int_eq(scan_state_save(&state, dir_fd, false), 0);
+    scan_state_close(&state);
+
+    // New rules invalidate everything that was recorded
+    add_mapping(".bin", "Binaries");
+    ck_assert_int_eq(scan_state_open(&state, config_folder, dir_fd), 0);
+    ck_assert(!scan_state_skipped_before(&state, dir_fd, "keep.bin"));
+    scan_state_close(&state);
+    close(dir_fd);
+
+    const char *names[] = { "a.txt", "b.txt", "keep.bin" };
+    for (size_t i = 0; i < 3; i++) {
+        snprintf(path, sizeof(path), "%s/%s", inbox, names[i]);
+        remove(path);
+    }
+    rmdir(inbox);
+    delete_config_files(config_folder);
+    rmdir(test_dir);
+    free(inbox);
+    free(config_folder);
+    free(test_dir);
+    free_existing_mappings();
+}
+END_TEST
+
+// Test that a dry run writes a plan and that applying it makes the moves
+START_TEST(test_move_plan)
+{
+    char *test_dir = create_temp_dir();
+    char *inbox = safe_path_join(test_dir, "inbox");
+    char *plan_path = safe_path_join(test_dir, "inbox.plan");
+    mkdir(inbox, 0755);
+    touch_file(inbox, "a.txt");
+    touch_file(inbox, "b.png");
+    touch_file(inbox, "c.zzz");
+
+    free_existing_mappings();
+    initialize_mappings();
+    add_mapping(".txt", "Documents");
+    add_mapping(".png", "Images");
+
+    MovePlan plan;
+    ck_assert_int_eq(move_plan_open(&plan, plan_path), 0);
+    move_plan = &plan;
+    int dir_fd = open(inbox, O_RDONLY | O_DIRECTORY);
+    FileBatch batch;
+    ck_assert(scan_directory_at(dir_fd, inbox, &batch));
+    MoveStats stats = process_file_batch(dir_fd, inbox, &batch, false);
+    free_file_batch(&batch);
+    close(dir_fd);
+    move_plan = NULL;
+    ck_assert_int_eq(move_plan_close(&plan), 0);
+    ck_assert_int_eq(stats.moved, 2);
+    ck_assert_int_eq(stats.skipped, 1);
+
+    // Nothing moved, nothing created
+    char path[MAX_PATH];
+    snprintf(path, sizeof(path), "%s/a.txt", inbox);
+    ck_assert_int_eq(access(path, F_OK), 0);
+    snprintf(path, sizeof(path), "%s/Images", inbox);
+    ck_assert_int_ne(access(path, F_OK), 0);
+
+    char *content = read_file_content(plan_path);
+    ck_assert_ptr_nonnull(strstr(content, "\"category\":\"Documents\",\"files\":[\"a.txt\"]}\n"));
+    ck_assert_ptr_nonnull(strstr(content, "\"category\":\"Images\",\"files\":[\"b.png\"]}\n"));
+    ck_assert_ptr_null(strstr(content, "c.zzz"));
+    free(content);
+
+    ck_assert_int_eq(apply_move_plan(plan_path), 0);
+    snprintf(path, sizeof(path), "%s/Documents/a.txt", inbox);
+    ck_assert_int_eq(access(path, F_OK), 0);
+    remove(path);
+    snprintf(path, sizeof(path), "%s/Images/b.png", inbox);
+    ck_assert_int_eq(access(path, F_OK), 0);
+    remove(path);
+
+    // A plan that tries to leave its directory is refused outright
+    FILE *file = fopen(plan_path, "w");
+    fprintf(file, "{\"directory\":\"%s\",\"category\":\"Notes\",\"files\":[\"c.zzz\"]}\n", inbox);
+    fprintf(file, "{\"directory\":\"%s\",\"category\":\"..\",\"files\":[\"c.zzz\"]}\n", inbox);
+    fclose(file);
+    ck_assert_int_ne(apply_move_plan(plan_path), 0);
+    snprintf(path, sizeof(path), "%s/c.zzz", inbox);
+    ck_assert_int_eq(access(path, F_OK), 0);
+    remove(path);
+
+    snprintf(path, sizeof(path), "%s/Documents", inbox);
+    rmdir(path);
+    snprintf(path, sizeof(path), "%s/Images", inbox);
+    rmdir(path);
+    rmdir(inbox);
+    remove(plan_path);
+    rmdir(test_dir);
+    free(plan_path);
+    free(inbox);
+    free(test_dir);
+    free_existing_mappings();
+}
+END_TEST
+
+// Test that a journal records each move and undo puts the files back
+START_TEST(test_move_journal)
+{
+    char *test_dir = create_temp_dir();
+    char *inbox = safe_path_join(test_dir, "inbox");
+    char *journal_path = safe_path_join(test_dir, "inbox.journal");
+    mkdir(inbox, 0755);
+    touch_file(inbox, "a.txt");
+    touch_file(inbox, "b.png");
+    touch_file(inbox, "c.zzz");
+    touch_file(inbox, "d.csv");
+    char path[MAX_PATH];
+    snprintf(path, sizeof(path), "%s/Sheets", inbox);
+    mkdir(path, 0755);
+
+    free_existing_mappings();
+    initialize_mappings();
+    add_mapping(".txt", "Documents");
+    add_mapping(".png", "Images");
+    add_mapping(".csv", "Sheets");
+
+    MoveJournal journal;
+    ck_assert_int_eq(move_journal_open(&journal, journal_path), 0);
+    move_journal = &journal;
+    int dir_fd = open(inbox, O_RDONLY | O_DIRECTORY);
+    FileBatch batch;
+    ck_assert(scan_directory_at(dir_fd, inbox, &batch));
+    MoveStats stats = process_file_batch(dir_fd, inbox, &batch, false);
+    free_file_batch(&batch);
+    close(dir_fd);
+    move_journal = NULL;
+    ck_assert_int_eq(move_journal_close(&journal), 0);
+    ck_assert_int_eq(stats.moved, 3);
+
+    // Something new has taken b.png's old name, so that one must stay put
+    touch_file(inbox, "b.png");
+    ck_assert_int_ne(undo_move_journal(journal_path), 0);
+
+    // Sheets was there before the run, so undo leaves the empty folder alone
+    snprintf(path, sizeof(path), "%s/d.csv", inbox);
+    ck_assert_int_eq(remove(path), 0);
+    snprintf(path, sizeof(path), "%s/Sheets", inbox);
+    ck_assert_int_eq(rmdir(path), 0);
+    snprintf(path, sizeof(path), "%s/a.txt", inbox);
+    ck_assert_int_eq(access(path, F_OK), 0);
+    remove(path);
+    snprintf(path, sizeof(path), "%s/Documents", inbox);
+    ck_assert_int_ne(access(path, F_OK), 0);
+    snprintf(path, sizeof(path), "%s/Images/b.png", inbox);
+    ck_assert_int_eq(access(path, F_OK), 0);
+    remove(path);
+    snprintf(path, sizeof(path), "%s/Images", inbox);
+    rmdir(path);
+    snprintf(path, sizeof(path), "%s/b.png", inbox);
+    remove(path);
+    snprintf(path, sizeof(path), "%s/c.zzz", inbox);
+    remove(path);
+
+    rmdir(inbox);
+    remove(journal_path);
+    rmdir(test_dir);
+    free(journal_path);
+    free(inbox);
+    free(test_dir);
+    free_existing_mappings();
+}
+END_TEST
+
+static void write_text_file(const char *folder, const char *name, const char *text) {
+    char *path = safe_path_join(folder, name);
+    FILE *file = fopen(path, "w");
+    fputs(text, file);
+    fclose(file);
+    free(path);
+}
+
+static MoveStats organize_once(const char *directory) {
+    int dir_fd = open(directory, O_RDONLY | O_DIRECTORY);
+    FileBatch batch;
+    scan_directory_at(dir_fd, directory, &batch);
+    MoveStats stats = process_file_batch(dir_fd, directory, &batch, false);
+    free_file_batch(&batch);
+    close(dir_fd);
+    return stats;
+}
+
+// Test that a name already in the category is never overwritten
+START_TEST(test_collision_policies)
+{
+    char *test_dir = create_temp_dir();
+    char *docs = safe_path_join(test_dir, "Docs");
+    mkdir(docs, 0755);
+    write_text_file(docs, "report.pdf", "old");
+    write_text_file(docs, "report-1.pdf", "older");
+    write_text_file(docs, "copy.pdf", "same");
+    write_text_file(test_dir, "report.pdf", "new");
+    write_text_file(test_dir, "copy.pdf", "same");
+
+    free_existing_mappings();
+    initialize_mappings();
+    add_mapping(".pdf", "Docs");
+
+    collision_policy = COLLISION_SKIP;
+    MoveStats stats = organize_once(test_dir);
+    ck_assert_int_eq(stats.moved, 0);
+    ck_assert_int_eq(stats.skipped, 2);
+
+    // An identical copy stays put, a different file gets the next free suffix
+    collision_policy = COLLISION_COMPARE;
+    stats = organize_once(test_dir);
+    ck_assert_int_eq(stats.moved, 1);
+    ck_assert_int_eq(stats.skipped, 1);
+
+    char path[MAX_PATH];
+    snprintf(path, sizeof(path), "%s/report-2.pdf", docs);
+    char *content = read_file_content(path);
+    ck_assert_str_eq(content, "new");
+    free(content);
+    snprintf(path, sizeof(path), "%s/report.pdf", docs);
+    content = read_file_content(path);
+    ck_assert_str_eq(content, "old");
+    free(content);
+
+    // The suffix goes before a compound extension, not inside it
+    write_text_file(docs, "a.tar.gz", "old");
+    write_text_file(test_dir, "a.tar.gz", "new");
+    add_mapping(".tar.gz", "Docs");
+
+    collision_policy = COLLISION_SUFFIX;
+    stats = organize_once(test_dir);
+    ck_assert_int_eq(stats.moved, 2);
+    snprintf(path, sizeof(path), "%s/copy-1.pdf", docs);
+    ck_assert_int_eq(access(path, F_OK), 0);
+    snprintf(path, sizeof(path), "%s/a-1.tar.gz", docs);
+    ck_assert_int_eq(access(path, F_OK), 0);
+
+    const char *names[] = { "report.pdf", "report-1.pdf", "report-2.pdf", "copy.pdf", "copy-1.pdf",
+                            "a.tar.gz", "a-1.tar.gz" };
+    for (size_t i = 0; i < 7; i++) {
+        snprintf(path, sizeof(path), "%s/%s", docs, names[i]);
+        ck_assert_int_eq(remove(path), 0);
+    }
+    rmdir(docs);
+    rmdir(test_dir);
+    free(docs);
+    free(test_dir);
+    free_existing_mappings();
+}
+END_TEST
+
+// Test that the mapping store grows past the old 1000 entry cap
+START_TEST(test_mapping_store_growth)
+{
+    free_existing_mappings();
+    initialize_mappings();
+
+    char extension[32];
+    for (int i = 0; i < 20000; i++) {
+        snprintf(extension, sizeof(extension), ".big%d", i);
+        add_mapping(extension, i % 2 ? "Odd" : "Even");
+    }
+
+    ck_assert_int_eq(mapping_count, 20000);
+    ck_assert_str_eq(get_category_for_extension(".big19999"), "Odd");
+
+    // Category names are interned, so every mapping shares one copy
+    ck_assert_ptr_eq(mappings[0].category, mappings[2].category);
+    ck_assert_ptr_eq(mappings[1].category, mappings[19999].category);
+
+    free_existing_mappings();
+    ck_assert_ptr_null(mappings);
+    ck_assert_int_eq(mapping_count, 0);
+}
+END_TEST
+
+// Test the single-pass directory scan
+START_TEST(test_scan_directory_batch)
+{
+    char *test_dir = create_temp_dir();
+
+    free_existing_mappings();
+    initialize_mappings();
+    add_mapping(".txt", "Documents");
+
+    char path[MAX_PATH];
+    snprintf(path, sizeof(path), "%s/notes.txt", test_dir);
+    fclose(fopen(path, "w"));
+    snprintf(path, sizeof(path), "%s/README", test_dir);
+    fclose(fopen(path, "w"));
+    snprintf(path, sizeof(path), "%s/subdir.txt", test_dir);
+    mkdir(path, 0755);
+    snprintf(path, sizeof(path), "%s/link.txt", test_dir);
+    ck_assert_int_eq(symlink("notes.txt", path), 0);
+
+    FileBatch batch;
+    ck_assert(scan_directory(test_dir, &batch));
+
+    // Only the two regular files are collected; dirs and symlinks are skipped
+    ck_assert_int_eq(batch.count, 2);
+    ck_assert(batch.has_uncategorized);
+    for (size_t i = 0; i < batch.count; i++) {
+        const char *name = batch.names + batch.entries[i].name_offset;
+        if (strcmp(name, "notes.txt") == 0) {
+            ck_assert_str_eq(batch.entries[i].category, "Documents");
+        } else {
+            ck_assert_str_eq(name, "README");
+            ck_assert_ptr_null(batch.entries[i].category);
+        }
+    }
+    free_file_batch(&batch);
+
+    // Clean up
+    remove(path);
+    snprintf(path, sizeof(path), "%s/subdir.txt", test_dir);
+    rmdir(path);
+    snprintf(path, sizeof(path), "%s/notes.txt", test_dir);
+    remove(path);
+    snprintf(path, sizeof(path), "%s/README", test_dir);
+    remove(path);
+    rmdir(test_dir);
+    free(test_dir);
+    free_existing_mappings();
+}
+END_TEST
+
+// Test organizing with a pool of move workers
+START_TEST(test_organize_files_with_jobs)
+{
+    char *test_dir = create_temp_dir();
+    char config_folder[MAX_PATH];
+    snprintf(config_folder, sizeof(config_folder), "%s/.fancyD", test_dir);
+    setenv("HOME", test_dir, 1);
+
+    ensure_config_folder(config_folder);
+    add_extension(config_folder, ".txt", "Documents");
+    add_extension(config_folder, ".jpg", "Images");
+
+    char file_path[MAX_PATH];
+    for (int i = 0; i < 500; i++) {
+        snprintf(file_path, sizeof(file_path), "%s/file%d.%s", test_dir, i, i % 2 ? "txt" : "jpg");
+        fclose(fopen(file_path, "w"));
+    }
+
+    jobs = 4;
+    organize_files(test_dir);
+    jobs = 0;
+
+    for (int i = 0; i < 500; i++) {
+        snprintf(file_path, sizeof(file_path), "%s/%s/file%d.%s", test_dir,
+                 i % 2 ? "Documents" : "Images", i, i % 2 ? "txt" : "jpg");
+        ck_assert_int_eq(access(file_path, F_OK), 0);
+    }
+
+    // Clean up
+    delete_config_files(test_dir);
+    unsetenv("HOME");
+}
+END_TEST
+
+// Test the copy-based move used when rename hits EXDEV
+START_TEST(test_move_across_devices)
+{
+    char *test_dir = create_temp_dir();
+    char path[MAX_PATH];
+
+    snprintf(path, sizeof(path), "%s/archive", test_dir);
+    mkdir(path, 0755);
+    snprintf(path, sizeof(path), "%s/report.pdf", test_dir);
+    FILE *file = fopen(path, "w");
+    fputs("quarterly numbers", file);
+    fclose(file);
+    chmod(path, 0640);
+    struct timespec times[2] = { { 1000000000, 0 }, { 1100000000, 0 } };
+    utimensat(AT_FDCWD, path, times, 0);
+
+    int dir_fd = open(test_dir, O_RDONLY | O_DIRECTORY);
+    snprintf(path, sizeof(path), "%s/archive", test_dir);
+    int archive_fd = open(path, O_RDONLY | O_DIRECTORY);
+    ck_assert_int_eq(move_across_devices(dir_fd, "report.pdf", archive_fd, "report.pdf"), 0);
+    close(archive_fd);
+    close(dir_fd);
+
+    // The original is gone and the copy keeps contents, mode and mtime
+    snprintf(path, sizeof(path), "%s/report.pdf", test_dir);
+    ck_assert_int_ne(access(path, F_OK), 0);
+
+    snprintf(path, sizeof(path), "%s/archive/report.pdf", test_dir);
+    struct stat st;
+    ck_assert_int_eq(stat(path, &st), 0);
+    ck_assert_int_eq(st.st_mode & 07777, 0640);
+    ck_assert_int_eq(st.st_mtim.tv_sec, 1100000000);
+
+    char content[64] = {0};
+    file = fopen(path, "r");
+    ck_assert_int_gt(fread(content, 1, sizeof(content) - 1, file), 0);
+    fclose(file);
+    ck_assert_str_eq(content, "quarterly numbers");
+
+    // An existing name is never replaced; the source stays and no copy is left behind
+    snprintf(path, sizeof(path), "%s/report.pdf", test_dir);
+    file = fopen(path, "w");
+    fputs("revised numbers", file);
+    fclose(file);
+    dir_fd = open(test_dir, O_RDONLY | O_DIRECTORY);
+    snprintf(path, sizeof(path), "%s/archive", test_dir);
+    archive_fd = open(path, O_RDONLY | O_DIRECTORY);
+    ck_assert_int_eq(move_across_devices(dir_fd, "report.pdf", archive_fd, "report.pdf"), -1);
+    ck_assert_int_eq(errno, EEXIST);
+    close(archive_fd);
+    DIR *archive = opendir(path);
+    int entries = 0;
+    struct dirent *ent;
+    while ((ent = readdir(archive)) != NULL) {
+        if (ent->d_name[0] != '.') entries++;
+        ck_assert_ptr_null(strstr(ent->d_name, ".tmp"));
+    }
+    closedir(archive);
+    ck_assert_int_eq(entries, 1);
+    close(dir_fd);
+
+    // A source truncated after it was measured fails the copy instead of
+    // publishing a short file, and the source itself is left alone
+    snprintf(path, sizeof(path), "%s/report.pdf", test_dir);
+    int src_fd = open(path, O_RDWR);
+    ck_assert_int_ne(src_fd, -1);
+    struct stat before;
+    ck_assert_int_eq(fstat(src_fd, &before), 0);
+    ck_assert_int_eq(ftruncate(src_fd, 7), 0);
+    snprintf(path, sizeof(path), "%s/archive/partial.tmp", test_dir);
+    int partial_fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0600);
+    ck_assert_int_eq(copy_file_data(src_fd, partial_fd, before.st_size), -1);
+    ck_assert_int_eq(errno, EIO);
+    close(partial_fd);
+    close(src_fd);
+    remove(path);
+    snprintf(path, sizeof(path), "%s/report.pdf", test_dir);
+    ck_assert_int_eq(stat(path, &st), 0);
+    ck_assert_int_eq(st.st_size, 7);
+    ck_assert_int_eq(remove(path), 0);
+
+    // Clean up
+    snprintf(path, sizeof(path), "%s/archive/report.pdf", test_dir);
+    remove(path);
+    snprintf(path, sizeof(path), "%s/archive", test_dir);
+    rmdir(path);
+    rmdir(test_dir);
+    free(test_dir);
+}
+END_TEST
+
+// Test the recursive tree walker
+START_TEST(test_organize_tree_recursive)
+{
+    char *test_dir = create_temp_dir();
+
+    free_existing_mappings();
+    initialize_mappings();
+    add_mapping(".txt", "Documents");
+    add_mapping(".jpg", "Images");
+
+    const char *dirs[] = { "sub", "sub/deep", "Images" };
+    const char *files[] = { "a.txt", "sub/b.jpg", "sub/deep/c.txt", "Images/old.txt" };
+    char path[MAX_PATH];
+    for (size_t i = 0; i < sizeof(dirs) / sizeof(dirs[0]); i++) {
+        snprintf(path, sizeof(path), "%s/%s", test_dir, dirs[i]);
+        mkdir(path, 0755);
+    }
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+        snprintf(path, sizeof(path), "%s/%s", test_dir, files[i]);
+        fclose(fopen(path, "w"));
+    }
+
+    MoveStats stats = organize_tree(test_dir, false, 1, 3);
+    ck_assert_int_eq(stats.moved, 2);
+
+    const char *expected[] = {
+        "Documents/a.txt",   // Sorted at the root
+        "sub/Images/b.jpg",  // Sorted in place one level down
+        "sub/deep/c.txt",    // Below --max-depth, left alone
+        "Images/old.txt"     // Category folders are not descended into
+    };
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        snprintf(path, sizeof(path), "%s/%s", test_dir, expected[i]);
+        ck_assert_msg(access(path, F_OK) == 0, "Expected %s to exist", path);
+    }
+
+    // Clean up
+    delete_config_files(test_dir);
+    free(test_dir);
+    free_existing_mappings();
+}
+END_TEST
+
+// Test that unchanged configs load from the compiled rule cache
+START_TEST(test_rule_cache)
+{
+    char *test_dir = create_temp_dir();
+    char config_folder[MAX_PATH];
+    snprintf(config_folder, sizeof(config_folder), "%s/.fancyD", test_dir);
+    ensure_config_folder(config_folder);
+
+    add_extension(config_folder, ".txt", "Documents");
+    add_extension(config_folder, ".jpg", "Images");
+
+    // The first load compiles the cache, the second one maps it
+    load_configs(config_folder);
+    char *cache_file = safe_path_join(config_folder, RULE_CACHE_FILE);
+    ck_assert_int_eq(access(cache_file, F_OK), 0);
+    free(cache_file);
+
+    load_configs(config_folder);
+    ck_assert(index_is_mapped);
+    ck_assert_int_eq(mapping_count, 2);
+    ck_assert_str_eq(get_category_for_extension(".TXT"), "Documents");
+    ck_assert(is_category_name("Images"));
+
+    // Adding to a cached index copies it instead of writing to the mapping
+    add_mapping(".png", "Images");
+    ck_assert(!index_is_mapped);
+    ck_assert_str_eq(get_category_for_extension(".png"), "Images");
+    ck_assert_str_eq(get_category_for_extension(".jpg"), "Images");
+
+    // Touching a config makes the cache stale
+    add_extension(config_folder, ".md", "Documents");
+    load_configs(config_folder);
+    ck_assert_str_eq(get_category_for_extension(".md"), "Documents");
+
+    // An out-of-range string offset is rejected and the JSON is parsed instead
+    cache_file = safe_path_join(config_folder, RULE_CACHE_FILE);
+    int fd = open(cache_file, O_RDWR);
+    ck_assert_int_ne(fd, -1);
+    RuleCacheHeader header;
+    ck_assert_int_eq(pread(fd, &header, sizeof(header), 0), (ssize_t)sizeof(header));
+    uint32_t bad_offset = UINT32_MAX;
+    off_t mapping_off = sizeof(header) + sizeof(RuleCacheSource) * header.source_count;
+    ck_assert_int_eq(pwrite(fd, &bad_offset, sizeof(bad_offset), mapping_off), (ssize_t)sizeof(bad_offset));
+    close(fd);
+    free(cache_file);
+
+    free_existing_mappings();
+    initialize_mappings();
+    ck_assert_int_eq(load_rule_cache(config_folder), -1);
+    load_configs(config_folder);
+    ck_assert(!index_is_mapped);
+    ck_assert_str_eq(get_category_for_extension(".md"), "Documents");
+
+    // Clean up
+    delete_config_files(test_dir);
+    free(test_dir);
+}
+END_TEST
+
+// Test the mmap-based JSON loader
+START_TEST(test_parse_json_file)
+{
+    char *test_dir = create_temp_dir();
+    char path[MAX_PATH];
+    cJSON *json;
+
+    snprintf(path, sizeof(path), "%s/missing_config.json", test_dir);
+    ck_assert_int_eq(parse_json_file(path, &json), -1);
+    ck_assert_ptr_null(json);
+
+    // Empty and malformed files are readable but don't parse
+    snprintf(path, sizeof(path), "%s/empty_config.json", test_dir);
+    fclose(fopen(path, "w"));
+    ck_assert_int_eq(parse_json_file(path, &json), 0);
+    ck_assert_ptr_null(json);
+    remove(path);
+
+    snprintf(path, sizeof(path), "%s/Images_config.json", test_dir);
+    FILE *file = fopen(path, "w");
+    fputs("{\".png\": \"Images\", \".gif\": \"Images\"}", file);
+    fclose(file);
+    ck_assert_int_eq(parse_json_file(path, &json), 0);
+    ck_assert_ptr_nonnull(json);
+    ck_assert_int_eq(cJSON_GetArraySize(json), 2);
+    cJSON_Delete(json);
+    remove(path);
+
+    rmdir(test_dir);
+    free(test_dir);
+}
+END_TEST
+
 Suite * fancy_suite(void)
 {
     Suite *s;
@@ -553,6 +1730,28 @@ Suite * fancy_suite(void)
     tcase_add_test(tc_core, test_add_duplicate_extension);
     tcase_add_test(tc_core, test_create_default_configs_with_existing);
     tcase_add_test(tc_core, test_organize_files_with_uncategorized);
+    tcase_add_test(tc_core, test_extension_index_lookup);
+    tcase_add_test(tc_core, test_mapping_store_growth);
+    tcase_add_test(tc_core, test_remove_mapping);
+    tcase_add_test(tc_core, test_add_extension_updates_cache);
+    tcase_add_test(tc_core, test_import_rules);
+    tcase_add_test(tc_core, test_create_default_configs_merge);
+    tcase_add_test(tc_core, test_concurrent_add_extension);
+    tcase_add_test(tc_core, test_write_config_json);
+    tcase_add_test(tc_core, test_compound_extension_match);
+    tcase_add_test(tc_core, test_glob_rules);
+    tcase_add_test(tc_core, test_sniff_content);
+    tcase_add_test(tc_core, test_watch_directory);
+    tcase_add_test(tc_core, test_scan_state);
+    tcase_add_test(tc_core, test_move_plan);
+    tcase_add_test(tc_core, test_move_journal);
+    tcase_add_test(tc_core, test_collision_policies);
+    tcase_add_test(tc_core, test_scan_directory_batch);
+    tcase_add_test(tc_core, test_organize_files_with_jobs);
+    tcase_add_test(tc_core, test_move_across_devices);
+    tcase_add_test(tc_core, test_organize_tree_recursive);
+    tcase_add_test(tc_core, test_rule_cache);
+    tcase_add_test(tc_core, test_parse_json_file);
     suite_add_tcase(s, tc_core);
     
     return s;